@@ -1,10 +1,526 @@
 #include <iostream>
 #include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <barrier>
+#include <atomic>
+#include <algorithm>
+#include <numbers>
+#include <bit>
+#include <array>
+#include <utility>
+#include <ostream>
+#include <cstddef>
+#include <span>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <compare>
+#include <type_traits>
+#include <new>
+#include <charconv>
+#include <cstdio>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 constexpr int CONST_MAX_LENGTH = 100;
 
+//positions inside caller-owned arrays, which can hold more than INT_MAX elements
+using Index = ptrdiff_t;
+
+// -----------------------------
+// Threads
+// -----------------------------
+//number of workers worth starting for n elements, 1 below the threshold
+size_t workerCount(size_t n, size_t threshold) {
+    if (n < threshold) return 1;
+    size_t hw = max<size_t>(1, thread::hardware_concurrency());
+    return min(hw, max<size_t>(1, n / (threshold / 2)));
+}
+
+//calls work(w) for every w in [0, workers), worker 0 runs on the calling thread
+template<typename F>
+void runParallel(size_t workers, F work) {
+    vector<thread> pool;
+    for (size_t w = 1; w < workers; ++w) pool.emplace_back(work, w);
+    work(size_t(0));
+    for (auto &t : pool) t.join();
+}
+
+// -----------------------------
+// Memory arenas
+// -----------------------------
+constexpr size_t ARENA_ALIGNMENT = 64;
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+//bump allocator for sort data and scratch space. Blocks are mapped on huge page
+//boundaries and backed by huge pages where the system allows it (MAP_HUGETLB, else
+//transparent huge pages through madvise), so a large array needs one TLB entry per
+//2 MiB instead of one per 4 KiB. Every allocation is ARENA_ALIGNMENT aligned and
+//nothing is freed on its own: rewind() drops everything allocated after a mark. When
+//the arena is rewound to empty, its blocks are merged into one, so after the largest
+//sort a long-running process maps no more memory. One arena per thread
+class CArena {
+public:
+    struct SMark {
+        size_t block;
+        size_t used;
+    };
+
+    CArena() = default;
+    ~CArena() { release(); }
+
+    CArena(const CArena&) = delete;
+    CArena& operator=(const CArena&) = delete;
+
+    void* allocate(size_t bytes) {
+        bytes = (max<size_t>(bytes, 1) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+        //blocks after the current one are empty, they were rewound
+        for (; current < blocks.size(); ++current) {
+            SBlock &b = blocks[current];
+            if (b.capacity - b.used >= bytes) return bump(b, bytes);
+        }
+        const size_t last = blocks.empty() ? 0 : blocks.back().capacity;
+        blocks.push_back(mapBlock(max({bytes, 2 * last, HUGE_PAGE_SIZE})));
+        current = blocks.size() - 1;
+        return bump(blocks.back(), bytes);
+    }
+
+    template<typename T>
+    T* allocate(size_t count) {
+        static_assert(alignof(T) <= ARENA_ALIGNMENT, "over-aligned type");
+        return static_cast<T*>(allocate(count * sizeof(T)));
+    }
+
+    [[nodiscard]] SMark mark() const {
+        if (blocks.empty()) return SMark{0, 0};
+        return SMark{current, blocks[current].used};
+    }
+
+    void rewind(SMark m) {
+        if (m.block >= blocks.size()) return;
+        for (size_t b = m.block + 1; b < blocks.size(); ++b) blocks[b].used = 0;
+        blocks[m.block].used = m.used;
+        current = m.block;
+        usedBytes = 0;
+        for (auto &b : blocks) usedBytes += b.used;
+        if (m.block == 0 && m.used == 0 && blocks.size() > 1) {
+            size_t total = 0;
+            for (auto &b : blocks) total += b.capacity;
+            release();
+            blocks.push_back(mapBlock(total));
+        }
+    }
+
+    void reset() { rewind(SMark{0, 0}); }
+
+    //most bytes in use at once since the arena was made
+    [[nodiscard]] size_t peakBytes() const { return peak; }
+
+    [[nodiscard]] size_t mappedBytes() const {
+        size_t total = 0;
+        for (auto &b : blocks) total += b.capacity;
+        return total;
+    }
+
+private:
+    struct SBlock {
+        char* base;
+        size_t capacity;
+        size_t used;
+    };
+
+    vector<SBlock> blocks;
+    size_t current = 0;
+    size_t usedBytes = 0;
+    size_t peak = 0;
+
+    void* bump(SBlock &b, size_t bytes) {
+        void* p = b.base + b.used;
+        b.used += bytes;
+        usedBytes += bytes;
+        peak = max(peak, usedBytes);
+        return p;
+    }
+
+    void release() {
+        for (auto &b : blocks) unmapBlock(b);
+        blocks.clear();
+        current = 0;
+        usedBytes = 0;
+    }
+
+    static SBlock mapBlock(size_t bytes) {
+        const size_t size = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#if defined(__unix__) || defined(__APPLE__)
+#ifdef MAP_HUGETLB
+        void* huge = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (huge != MAP_FAILED) return SBlock{static_cast<char*>(huge), size, 0};
+#endif
+        //no reserved huge pages: map one huge page more and trim, so the block starts
+        //on a huge page boundary and can be backed by transparent huge pages
+        const size_t mapped = size + HUGE_PAGE_SIZE;
+        void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw bad_alloc();
+        char* first = static_cast<char*>(raw);
+        char* base = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(first) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+        if (base > first) munmap(first, static_cast<size_t>(base - first));
+        if (base + size < first + mapped) munmap(base + size, static_cast<size_t>(first + mapped - (base + size)));
+#ifdef MADV_HUGEPAGE
+        madvise(base, size, MADV_HUGEPAGE);
+#endif
+        return SBlock{base, size, 0};
+#else
+        return SBlock{static_cast<char*>(::operator new(size, align_val_t(HUGE_PAGE_SIZE))), size, 0};
+#endif
+    }
+
+    static void unmapBlock(const SBlock &b) {
+#if defined(__unix__) || defined(__APPLE__)
+        munmap(b.base, b.capacity);
+#else
+        ::operator delete(b.base, align_val_t(HUGE_PAGE_SIZE));
+#endif
+    }
+};
+
+//rewinds the arena to where it was when the scope was opened
+class CArenaScope {
+public:
+    explicit CArenaScope(CArena &arena): arena(arena), start(arena.mark()) {}
+    ~CArenaScope() { arena.rewind(start); }
+
+    CArenaScope(const CArenaScope&) = delete;
+    CArenaScope& operator=(const CArenaScope&) = delete;
+
+private:
+    CArena &arena;
+    CArena::SMark start;
+};
+
+//standard allocator over an arena, deallocate is a no-op until the arena is rewound
+template<typename T>
+class CArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit CArenaAllocator(CArena &arena): arena(&arena) {}
+    template<typename U>
+    CArenaAllocator(const CArenaAllocator<U> &other): arena(other.arena) {}
+
+    T* allocate(size_t n) { return arena->allocate<T>(n); }
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const CArenaAllocator<U> &other) const { return arena == other.arena; }
+
+    CArena* arena;
+};
+
+template<typename T>
+using ArenaVector = vector<T, CArenaAllocator<T>>;
+
+//the arena the sorting functions use when the caller does not pass one; it lives as
+//long as its thread and keeps the memory of its largest sort
+CArena& threadArena() {
+    thread_local CArena arena;
+    return arena;
+}
+
+// -----------------------------
+// Compile-time sorting networks
+// -----------------------------
+//up to this size fixed arrays are sorted by a network, above it by insertion sort
+constexpr size_t NETWORK_MAX_SIZE = 32;
+
+struct SComparator {
+    unsigned char i;
+    unsigned char j;
+};
+
+//Batcher's odd-even merge sort network for n inputs, comparators that would touch
+//an index >= n are left out (the same as padding with +infinity). visit(i, j) is
+//called for every comparator in order
+template<typename F>
+constexpr void forEachComparator(size_t n, F visit) {
+    for (size_t p = 1; p < n; p *= 2) {
+        for (size_t k = p; k >= 1; k /= 2) {
+            for (size_t j = k % p; j + k < n; j += 2 * k) {
+                for (size_t i = 0; i < k && i + j + k < n; ++i) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) visit(i + j, i + j + k);
+                }
+            }
+        }
+    }
+}
+
+constexpr size_t networkSize(size_t n) {
+    size_t count = 0;
+    forEachComparator(n, [&count](size_t, size_t) { ++count; });
+    return count;
+}
+
+template<size_t N>
+constexpr auto makeSortingNetwork() {
+    array<SComparator, networkSize(N)> network{};
+    size_t c = 0;
+    forEachComparator(N, [&](size_t i, size_t j) {
+        network[c++] = SComparator{static_cast<unsigned char>(i), static_cast<unsigned char>(j)};
+    });
+    return network;
+}
+
+template<size_t N>
+inline constexpr auto SORTING_NETWORK = makeSortingNetwork<N>();
+
+//sorts N elements whose count is known at compile time, ascending by operator< like
+//CSorter. Usable in constant expressions; at run time the network is fully unrolled
+//into branch-free min/max pairs
+template<typename T, size_t N>
+class CFixedSorter {
+public:
+    static constexpr void sort(T array[]) {
+        if constexpr (N <= 1) {
+            return;
+        } else if constexpr (N <= NETWORK_MAX_SIZE) {
+            applyNetwork(array, make_index_sequence<SORTING_NETWORK<N>.size()>{});
+        } else {
+            for (size_t i = 1; i < N; ++i) {
+                for (size_t j = i; j > 0 && array[j] < array[j - 1]; --j) {
+                    T aux = array[j];
+                    array[j] = array[j - 1];
+                    array[j - 1] = aux;
+                }
+            }
+        }
+    }
+
+    static constexpr void sort(array<T, N> &values) {
+        sort(values.data());
+    }
+
+    static constexpr array<T, N> sorted(array<T, N> values) {
+        sort(values.data());
+        return values;
+    }
+
+    static constexpr size_t comparators() {
+        return N <= NETWORK_MAX_SIZE ? SORTING_NETWORK<N>.size() : 0;
+    }
+
+private:
+    static constexpr void compareExchange(T array[], size_t i, size_t j) {
+        T a = array[i];
+        T b = array[j];
+        array[i] = b < a ? b : a;
+        array[j] = b < a ? a : b;
+    }
+
+    template<size_t... C>
+    static constexpr void applyNetwork(T array[], index_sequence<C...>) {
+        (compareExchange(array, SORTING_NETWORK<N>[C].i, SORTING_NETWORK<N>[C].j), ...);
+    }
+};
+
+static_assert(CFixedSorter<int, 5>::sorted({8, 7, 9, 2, 3}) == array<int, 5>{2, 3, 7, 8, 9});
+static_assert(networkSize(16) == 63 && networkSize(32) == 191);
+
+// -----------------------------
+// Input generators
+// -----------------------------
+enum DistKind {
+    DIST_UNIFORM = 0,
+    DIST_SORTED,
+    DIST_REVERSED,
+    DIST_FEW_UNIQUE,
+    DIST_SAWTOOTH,
+    DIST_ORGAN_PIPE,
+    DIST_ZIPF,
+    DIST_GAUSSIAN,
+    DIST_NEARLY_SORTED,
+    DIST_COUNT
+};
+
+const char* const DIST_NAMES[DIST_COUNT] = {
+    "uniform", "sorted", "reversed", "few-unique", "sawtooth",
+    "organ-pipe", "zipf", "gaussian", "nearly-sorted"
+};
+
+//every chunk gets its own generator, so the output for a seed does not
+//depend on how many threads filled the array
+constexpr size_t GEN_CHUNK = size_t(1) << 16;
+constexpr size_t GEN_PARALLEL_THRESHOLD = size_t(1) << 20;
+constexpr int GEN_FEW_UNIQUE_VALUES = 8;
+constexpr int GEN_SAWTOOTH_TEETH = 5;
+constexpr size_t GEN_ZIPF_MAX_RANKS = size_t(1) << 16;
+
+//xoshiro256** seeded through splitmix64
+struct SXoshiro256 {
+    uint64_t s[4];
+
+    explicit SXoshiro256(uint64_t seed) {
+        for (auto &w : s) w = splitMix64(seed);
+    }
+
+    static uint64_t splitMix64(uint64_t &x) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t next() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    //value in [0, bound), bound must fit in 32 bits (Lemire's multiply-shift)
+    uint64_t below(uint64_t bound) { return ((next() >> 32) * bound) >> 32; }
+
+    //value in [0, 1)
+    double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+};
+
+class CInputGenerator {
+public:
+    CInputGenerator(DistKind kind, uint64_t seed, int lo, int hi, int swapPercent = 5)
+        : kind(kind), seed(seed), lo(lo), hi(hi), swapPercent(swapPercent) {
+        if (kind == DIST_ZIPF) buildZipfTable();
+    }
+
+    void fill(int out[], size_t n) const {
+        if (n == 0) return;
+        const size_t chunks = (n + GEN_CHUNK - 1) / GEN_CHUNK;
+
+        atomic<size_t> nextChunk{0};
+        runParallel(workerCount(n, GEN_PARALLEL_THRESHOLD), [&](size_t) {
+            for (size_t c = nextChunk++; c < chunks; c = nextChunk++) {
+                fillChunk(out, n, c * GEN_CHUNK, min(n, (c + 1) * GEN_CHUNK), c);
+            }
+        });
+
+        //the random swaps are a global pass, kept sequential so they reproduce
+        if (kind == DIST_NEARLY_SORTED && n > 1) {
+            SXoshiro256 rng(seed ^ 0xD1B54A32D192ED03ULL);
+            const size_t swaps = n * static_cast<size_t>(swapPercent) / 100;
+            for (size_t k = 0; k < swaps; ++k) {
+                swap(out[rng.below(n)], out[rng.below(n)]);
+            }
+        }
+    }
+
+private:
+    DistKind kind;
+    uint64_t seed;
+    int lo;
+    int hi;
+    int swapPercent;
+    vector<double> zipfCdf;
+
+    [[nodiscard]] uint64_t range() const { return static_cast<uint64_t>(int64_t(hi) - lo) + 1; }
+
+    //value at position k of an ascending ramp from lo to hi over n elements
+    [[nodiscard]] int ramp(size_t k, size_t n) const {
+        if (n <= 1) return lo;
+        double t = static_cast<double>(k) / static_cast<double>(n - 1);
+        return static_cast<int>(lo + static_cast<int64_t>(t * static_cast<double>(range() - 1)));
+    }
+
+    void buildZipfTable() {
+        const size_t ranks = min<uint64_t>(range(), GEN_ZIPF_MAX_RANKS);
+        zipfCdf.resize(ranks);
+        double sum = 0.0;
+        for (size_t r = 0; r < ranks; ++r) {
+            sum += 1.0 / static_cast<double>(r + 1);
+            zipfCdf[r] = sum;
+        }
+        for (auto &c : zipfCdf) c /= sum;
+    }
+
+    void fillChunk(int out[], size_t n, size_t begin, size_t end, size_t chunk) const {
+        SXoshiro256 rng(seed + chunk * 0x9E3779B97F4A7C15ULL);
+        const uint64_t r = range();
+
+        for (size_t k = begin; k < end; ++k) {
+            int v;
+            switch (kind) {
+                case DIST_SORTED:
+                case DIST_NEARLY_SORTED:
+                    v = ramp(k, n);
+                    break;
+                case DIST_REVERSED:
+                    v = ramp(n - 1 - k, n);
+                    break;
+                case DIST_FEW_UNIQUE: {
+                    auto bucket = static_cast<double>(rng.below(GEN_FEW_UNIQUE_VALUES));
+                    v = static_cast<int>(lo + static_cast<int64_t>(bucket * static_cast<double>(r - 1) / (GEN_FEW_UNIQUE_VALUES - 1)));
+                    break;
+                }
+                case DIST_SAWTOOTH: {
+                    size_t period = max<size_t>(2, (n + GEN_SAWTOOTH_TEETH - 1) / GEN_SAWTOOTH_TEETH);
+                    v = ramp(k % period, period);
+                    break;
+                }
+                case DIST_ORGAN_PIPE: {
+                    size_t half = (n + 1) / 2;
+                    v = k < half ? ramp(k, half) : ramp(n - 1 - k, half);
+                    break;
+                }
+                case DIST_ZIPF: {
+                    double u = rng.unit();
+                    size_t rank = lower_bound(zipfCdf.begin(), zipfCdf.end(), u) - zipfCdf.begin();
+                    rank = min(rank, zipfCdf.size() - 1);
+                    v = static_cast<int>(lo + static_cast<int64_t>(rank * r / zipfCdf.size()));
+                    break;
+                }
+                case DIST_GAUSSIAN: {
+                    //Box-Muller, mean in the middle of the range, 3 sigma to the edges
+                    double u1 = 1.0 - rng.unit();
+                    double u2 = rng.unit();
+                    double z = sqrt(-2.0 * log(u1)) * cos(2.0 * numbers::pi * u2);
+                    double mid = (static_cast<double>(lo) + hi) / 2.0;
+                    double x = mid + z * static_cast<double>(r) / 6.0;
+                    x = min<double>(max<double>(x, lo), hi);
+                    v = static_cast<int>(x);
+                    break;
+                }
+                case DIST_UNIFORM:
+                default:
+                    v = static_cast<int>(lo + static_cast<int64_t>(rng.below(r)));
+                    break;
+            }
+            out[k] = v;
+        }
+    }
+};
+
+DistKind parseDistribution(const char* name) {
+    for (int d = 0; d < DIST_COUNT; ++d) {
+        if (strcmp(name, DIST_NAMES[d]) == 0) return static_cast<DistKind>(d);
+    }
+    return DIST_COUNT;
+}
+
 class CSorter {
 protected:
     int data[CONST_MAX_LENGTH];
@@ -25,21 +541,25 @@ public:
     }
 
     void selectionSort() {
-        for (int j = 0; j < size - 1; j++){
+        selectionSort(data, size);
+    }
+
+    static void selectionSort(int array[], Index n) {
+        for (Index j = 0; j < n - 1; j++){
             int min = INT_MAX;
-            int pos_min = -1;
-            for (int i = j; i < size; i++) {
-                int elem = data[i];
+            Index pos_min = j;
+            for (Index i = j; i < n; i++) {
+                int elem = array[i];
                 if (elem < min) {
                     min = elem;
                     pos_min = i;
                 }
             }
-            //swap data[j] with data[pos_min]
+            //swap array[j] with array[pos_min]
             if (pos_min != j) {
-                int aux = data[j];
-                data[j] = data[pos_min];
-                data[pos_min]= aux;
+                int aux = array[j];
+                array[j] = array[pos_min];
+                array[pos_min]= aux;
             }
         }
     }
@@ -50,10 +570,14 @@ public:
     virtual void quickSort() {}
 
     void insertionSort() {
-        for (int i = 0; i<= size - 1; i++) {
-            int j = i;
-            while (j > 0 and data[j-1] > data[j]) {
-                swap(data[j] , data[j-1]);
+        insertionSort(data, size);
+    }
+
+    static void insertionSort(int array[], Index n) {
+        for (Index i = 0; i<= n - 1; i++) {
+            Index j = i;
+            while (j > 0 and array[j-1] > array[j]) {
+                swap(array[j] , array[j-1]);
                 j--;
             }
         }
@@ -66,86 +590,310 @@ public:
     CHeapSorter(const int input[], int n): CSorter(input, n){}
 
     void heapSort(){
+        heapSort(data, size);
+    }
+
+    static void heapSort(int array[], Index size) {
         //build the maxheap
-        for (int i = size/2-1; i >=0; i--) {
-            heapify(size, i);
+        for (Index i = size/2-1; i >=0; i--) {
+            heapify(array, size, i);
         }
 
-        for (int i = size -1; i > 0; i--) {
-            swap(data[0],data[i]);
-            heapify(i,0);
+        for (Index i = size -1; i > 0; i--) {
+            swap(array[0],array[i]);
+            heapify(array, i,0);
         }
 
     }
 
 private:
-    void heapify(int n, int i) {
+    static void heapify(int array[], Index n, Index i) {
 
-        int largest = i;
-        int left =  2*i + 1;
-        int right = 2*i + 2;
+        Index largest = i;
+        Index left =  2*i + 1;
+        Index right = 2*i + 2;
 
-        if (left < n && data[left] > data[largest]) {
+        if (left < n && array[left] > array[largest]) {
             largest = left;
         }
-        if (right < n && data[right] > data[largest]){
+        if (right < n && array[right] > array[largest]){
             largest = right;
         }
         if (largest != i) {
-            swap(data[i], data[largest]);
-            heapify(n,largest);
+            swap(array[i], array[largest]);
+            heapify(array, n,largest);
+        }
+
+    }
+};
+
+
+// -----------------------------
+// K-way merging
+// -----------------------------
+struct SRun {
+    const int* begin;
+    const int* end;
+};
+
+//tournament tree of losers over k runs. Every internal node keeps the loser of the
+//match played there and tree[0] keeps the overall winner, so replacing the winner
+//replays a single leaf-to-root path: log2(k) comparisons per element.
+//Nodes hold (key, run) packed into one 64-bit value, so a match is one integer
+//comparison, ties go to the lower run index (which keeps the merge stable) and an
+//exhausted run is simply the largest possible value.
+class CLoserTree {
+public:
+    CLoserTree(const SRun runs[], int k): heads(runs, runs + k), tree(max(k, 1)), k(k) {
+        if (k == 0) return;
+        //play the initial tournament bottom-up, leaves are nodes k..2k-1
+        vector<uint64_t> winners(2 * k);
+        for (int r = 0; r < k; ++r) winners[k + r] = headKey(r);
+        for (int node = k - 1; node >= 1; --node) {
+            uint64_t a = winners[2 * node], b = winners[2 * node + 1];
+            winners[node] = min(a, b);
+            tree[node] = max(a, b);
+        }
+        tree[0] = winners[1];
+    }
+
+    //calls out(value) for every element in merged order, nothing is buffered
+    template<typename F>
+    void mergeInto(F out) {
+        if (k == 0) return;
+        while (tree[0] != EXHAUSTED) {
+            int run = static_cast<int>(tree[0] & 0xFFFFFFFFu);
+            out(*heads[run].begin++);
+            replay(run);
         }
+    }
+
+private:
+    static constexpr uint64_t EXHAUSTED = ~uint64_t(0);
 
+    vector<SRun> heads;
+    vector<uint64_t> tree;
+    int k;
+
+    //key biased to unsigned in the high half, run index in the low half
+    [[nodiscard]] uint64_t headKey(int run) const {
+        if (heads[run].begin == heads[run].end) return EXHAUSTED;
+        uint32_t key = static_cast<uint32_t>(*heads[run].begin) ^ 0x80000000u;
+        return (uint64_t(key) << 32) | static_cast<uint32_t>(run);
+    }
+
+    void replay(int run) {
+        uint64_t winner = headKey(run);
+        for (int node = (k + run) / 2; node >= 1; node /= 2) {
+            if (tree[node] < winner) swap(tree[node], winner);
+        }
+        tree[0] = winner;
     }
 };
 
+//merges k sorted runs into out, which must not overlap them
+inline void kWayMerge(const SRun runs[], int k, int out[]) {
+    CLoserTree tree(runs, k);
+    tree.mergeInto([&out](int v) { *out++ = v; });
+}
+
+//runs of this many elements are insertion sorted before the multiway passes
+constexpr int MULTIWAY_BASE_RUN = 32;
+//8 to 16 input streams keep their current cache lines resident in L1
+constexpr int MULTIWAY_FANOUT = 8;
+//runs of this many elements are insertion sorted before the in-place merge passes
+constexpr Index INPLACE_MERGE_RUN = 32;
+//size of the fixed buffer of the in-place merge; a merge with a side that fits goes
+//through it in linear time, longer ones are split by rotations
+constexpr Index INPLACE_MERGE_BUFFER = 512;
 
 class CMergeSorter : public CSorter {
 public:
     CMergeSorter(const int input[], int n): CSorter(input , n){}
 
     void mergeSort() override {
-        mergeSortHelper(data,size);
+        int scratch[CONST_MAX_LENGTH];
+        mergeSortHelper(data, scratch, size);
     }
-private:
-    void mergeSortHelper(int array[] ,int length) {
 
-        // int length = sizeof(array) / 4;
+    //scratch needs room for length / 2 elements
+    static void mergeSort(int array[], Index length, int scratch[]) {
+        mergeSortHelper(array, scratch, length);
+    }
 
-        if (length <= 1) {
-            return;
+    void mergeSortMultiway(int fanout = MULTIWAY_FANOUT) {
+        int scratch[CONST_MAX_LENGTH];
+        mergeSortMultiway(data, size, scratch, fanout);
+    }
+
+    void mergeSortInPlace() {
+        int buffer[INPLACE_MERGE_BUFFER];
+        mergeSortInPlace(data, size, buffer);
+    }
+
+    //stable bottom-up merge sort in O(1) extra memory: buffer holds
+    //INPLACE_MERGE_BUFFER elements whatever the length. Merges whose shorter side fits
+    //in the buffer are plain buffered merges; longer ones are SymMerge (Kim and
+    //Kutzner), which rotates the middle into place and recurses on both sides, so a
+    //sort takes O(n log n) comparisons and O(n log^2 n) moves
+    template<typename T, typename Less = less<>>
+    static void mergeSortInPlace(T array[], Index length, T buffer[], Less less = {}) {
+        for (Index start = 0; start < length; start += INPLACE_MERGE_RUN) {
+            insertionSortRun(array + start, min(INPLACE_MERGE_RUN, length - start), less);
+        }
+        for (Index width = INPLACE_MERGE_RUN; width < length; width *= 2) {
+            for (Index first = 0; first + width < length; first += 2 * width) {
+                mergeInPlace(array, first, first + width, min(first + 2 * width, length), buffer, less);
+            }
+        }
+    }
+
+    //array[0, sorted) is in order and array[sorted, length) holds new values: the new
+    //values are sorted on their own and merged in from the back, so only the part of
+    //the array above the smallest new value moves. Takes O(n + d log d) for d new
+    //values; scratch needs room for d elements
+    static void mergeTail(int array[], Index length, Index sorted, int scratch[]) {
+        const Index d = length - sorted;
+        if (d <= 0) return;
+        mergeSortHelper(array + sorted, scratch, d);
+        if (sorted == 0 || array[sorted - 1] <= array[sorted]) return;
+
+        copy(array + sorted, array + length, scratch);
+        Index l = sorted, r = d, out = length;
+        while (l > 0 && r > 0) {
+            array[--out] = scratch[r - 1] < array[l - 1] ? array[--l] : scratch[--r];
         }
+        copy(scratch, scratch + r, array);
+    }
 
-        int middle = length / 2;
-        int leftArray[CONST_MAX_LENGTH];
-        int rightArray[CONST_MAX_LENGTH];
-        int leftSize = middle;
-        int rightSize = length - middle;
+    //array was in order before the entries at the count ascending, distinct indices in
+    //changed were overwritten. The unchanged entries slide down over the gaps, the
+    //changed ones go behind them and mergeTail puts them in place; scratch needs room
+    //for count elements
+    static void resortChanged(int array[], Index length, const Index changed[], Index count, int scratch[]) {
+        for (Index c = 0; c < count; ++c) {
+            scratch[c] = array[changed[c]];
+            const Index next = c + 1 < count ? changed[c + 1] : length;
+            copy(array + changed[c] + 1, array + next, array + changed[c] - c);
+        }
+        copy(scratch, scratch + count, array + length - count);
+        mergeTail(array, length, length - count, scratch);
+    }
 
-        int i = 0;
-        int j = 0;
+    //bottom-up merge sort that merges fanout runs per pass with a loser tree, so it
+    //makes log_fanout(n) passes over memory instead of log2(n); scratch needs length
+    //elements
+    static void mergeSortMultiway(int array[], Index length, int scratch[], int fanout = MULTIWAY_FANOUT) {
+        fanout = max(fanout, 2);
+        for (Index start = 0; start < length; start += MULTIWAY_BASE_RUN) {
+            CSorter::insertionSort(array + start, min<Index>(MULTIWAY_BASE_RUN, length - start));
+        }
 
-        for (; i<length; i++) {
-            if (i< middle) {
-                leftArray[i] = array[i];
+        int* src = array;
+        int* dst = scratch;
+        vector<SRun> runs(static_cast<size_t>(fanout));
+        for (Index width = MULTIWAY_BASE_RUN; width < length; width *= fanout) {
+            for (Index start = 0; start < length; start += width * fanout) {
+                int k = 0;
+                for (Index r = start; r < length && k < fanout; r += width, ++k) {
+                    runs[k] = SRun{src + r, src + min<Index>(r + width, length)};
+                }
+                kWayMerge(runs.data(), k, dst + start);
             }
-            else {
-                rightArray[j] = array[i];
-                j++;
+            swap(src, dst);
+        }
+        if (src != array) {
+            copy(src, src + length, array);
+        }
+    }
+private:
+    template<typename T, typename Less>
+    static void insertionSortRun(T array[], Index n, Less less) {
+        for (Index i = 1; i < n; ++i) {
+            T key = array[i];
+            Index j = i;
+            for (; j > 0 && less(key, array[j - 1]); --j) array[j] = array[j - 1];
+            array[j] = key;
+        }
+    }
+
+    //stable merge of the sorted ranges [first, middle) and [middle, last)
+    template<typename T, typename Less>
+    static void mergeInPlace(T array[], Index first, Index middle, Index last, T buffer[], Less less) {
+        if (first == middle || middle == last || !less(array[middle], array[middle - 1])) return;
+
+        if (middle - first <= INPLACE_MERGE_BUFFER) {
+            //left side into the buffer, merged front to back; ties take the left element
+            copy(array + first, array + middle, buffer);
+            Index l = 0, r = middle, out = first;
+            const Index leftSize = middle - first;
+            while (l < leftSize && r < last) {
+                array[out++] = less(array[r], buffer[l]) ? array[r++] : buffer[l++];
+            }
+            copy(buffer + l, buffer + leftSize, array + out);
+            return;
+        }
+        if (last - middle <= INPLACE_MERGE_BUFFER) {
+            //right side into the buffer, merged back to front; ties take the right element
+            copy(array + middle, array + last, buffer);
+            Index l = middle, r = last - middle, out = last;
+            while (l > first && r > 0) {
+                array[--out] = less(buffer[r - 1], array[l - 1]) ? array[--l] : buffer[--r];
             }
+            copy(buffer, buffer + r, array + first);
+            return;
+        }
+
+        //find the split where the tail of the left side and the head of the right side
+        //swap places so that both halves of [first, last) become independent merges
+        const Index mid = first + (last - first) / 2;
+        const Index n = mid + middle;
+        Index start = middle > mid ? n - last : first;
+        Index r = middle > mid ? mid : middle;
+        while (start < r) {
+            Index c = start + (r - start) / 2;
+            if (!less(array[n - 1 - c], array[c])) {
+                start = c + 1;
+            } else {
+                r = c;
+            }
+        }
+        const Index end = n - start;
+        if (start < middle && middle < end) rotate(array + start, array + middle, array + end);
+        if (first < start && start < mid) mergeInPlace(array, first, start, mid, buffer, less);
+        if (mid < end && end < last) mergeInPlace(array, mid, end, last, buffer, less);
+    }
+
+    //halves that are already in order are not merged, so presorted runs cost a
+    //single comparison per level
+    static void mergeSortHelper(int array[], int scratch[], Index length) {
+
+        if (length <= 1) {
+            return;
+        }
+
+        Index middle = length / 2;
+        Index leftSize = middle;
+        Index rightSize = length - middle;
+
+        mergeSortHelper(array, scratch, leftSize);
+        mergeSortHelper(array + middle, scratch, rightSize);
+        if (array[middle - 1] <= array[middle]) {
+            return;
         }
-        mergeSortHelper(leftArray, leftSize);
-        mergeSortHelper(rightArray, rightSize);
-        merge(leftArray,leftSize,rightArray,rightSize, array);
+
+        //only the left half is copied out, writes never overtake the right half
+        copy(array, array + leftSize, scratch);
+        merge(scratch, leftSize, array + middle, rightSize, array);
 
 
     }
 
-    void merge(int leftArray[],int leftSize, int rightArray[],int rightSize, int array[]) {
-        int i = 0, l =0, r =0;
+    static void merge(const int leftArray[],Index leftSize, const int rightArray[],Index rightSize, int array[]) {
+        Index i = 0, l =0, r =0;
 
         while (l < leftSize && r < rightSize) {
-            if (leftArray[l] < rightArray[r]) {
+            if (leftArray[l] <= rightArray[r]) {
                 array[i] = leftArray[l];
                 i++;
                 l++;
@@ -173,26 +921,131 @@ private:
 
 };
 
+//PART_THREE_WAY keeps keys equal to the pivot out of the recursion (Bentley-McIlroy),
+//so inputs with few distinct values sort in close to linear time
+enum PartitionMode {
+    PART_LOMUTO = 0,
+    PART_THREE_WAY = 1
+};
+
 class CQuickSorter : public CSorter {
 public:
-    CQuickSorter(int input[], int n): CSorter(input, n) {}
+    CQuickSorter(int input[], int n, PartitionMode mode = PART_LOMUTO): CSorter(input, n), mode(mode) {}
 
 
     void quickSort() override {
-        quickSortRecursive(data, 0, size - 1);
+        quickSort(data, size, mode);
+    }
+
+    static void quickSort(int array[], Index n, PartitionMode mode = PART_LOMUTO) {
+        if (mode == PART_THREE_WAY) {
+            quickSortThreeWay(array, 0, n - 1);
+        } else {
+            quickSortRecursive(array, 0, n - 1);
+        }
+    }
+
+    void introSort() {
+        introSort(data, size);
+    }
+
+    //three-way quick sort with a median-of-three pivot that falls back to heap sort
+    //when the recursion gets too deep and finishes small ranges with insertion sort
+    static void introSort(int array[], Index n) {
+        if (n <= 1) {
+            return;
+        }
+        introSortRecursive(array, 0, n - 1, 2 * static_cast<int>(bit_width(static_cast<size_t>(n))));
     }
 
 
 private:
+    PartitionMode mode;
+
+    static constexpr int INTRO_INSERTION_THRESHOLD = 16;
+
+    static void introSortRecursive(int array[], Index start, Index end, int depthLimit) {
+        while (end - start + 1 > INTRO_INSERTION_THRESHOLD) {
+            if (depthLimit-- == 0) {
+                CHeapSorter::heapSort(array + start, end - start + 1);
+                return;
+            }
+
+            //order start, middle, end and move the median to end as the pivot
+            Index middle = start + (end - start) / 2;
+            if (array[middle] < array[start]) swap(array[middle], array[start]);
+            if (array[end] < array[start]) swap(array[end], array[start]);
+            if (array[end] < array[middle]) swap(array[end], array[middle]);
+            swap(array[middle], array[end]);
+
+            Index lt, gt;
+            partitionThreeWay(array, start, end, lt, gt);
+
+            //recurse into the smaller side, loop on the larger one
+            if (lt - start < end - gt) {
+                introSortRecursive(array, start, lt, depthLimit);
+                start = gt;
+            } else {
+                introSortRecursive(array, gt, end, depthLimit);
+                end = lt;
+            }
+        }
+        if (start < end) {
+            CSorter::insertionSort(array + start, end - start + 1);
+        }
+    }
+
+    static void quickSortThreeWay(int array[], Index start, Index end) {
+
+        if (start >= end) {
+            return;
+        }
+        Index lt, gt;
+        partitionThreeWay(array, start, end, lt, gt);
+
+        quickSortThreeWay(array, start, lt);
+        quickSortThreeWay(array, gt, end);
+    }
+
+    //partitions around array[end]; afterwards [start..lt] < pivot, (lt..gt) == pivot
+    //and [gt..end] > pivot
+    static void partitionThreeWay(int array[], Index start, Index end, Index &lt, Index &gt) {
+        int pivot = array[end];
+        //keys equal to the pivot are parked in [start..p] and [q..end-1] while scanning
+        Index i = start - 1, j = end;
+        Index p = start - 1, q = end;
+
+        while (true) {
+            while (array[++i] < pivot) {}
+            while (pivot < array[--j]) {
+                if (j == start) break;
+            }
+            if (i >= j) break;
+
+            swap(array[i], array[j]);
+            if (array[i] == pivot) swap(array[++p], array[i]);
+            if (array[j] == pivot) swap(array[--q], array[j]);
+        }
+        swap(array[i], array[end]);
 
-    void quickSortRecursive(int array[], int start, int end) {
+        //move the parked equal keys next to the pivot
+        j = i - 1;
+        i = i + 1;
+        for (Index k = start; k <= p; ++k, --j) swap(array[k], array[j]);
+        for (Index k = end - 1; k >= q; --k, ++i) swap(array[k], array[i]);
+
+        lt = j;
+        gt = i;
+    }
+
+    static void quickSortRecursive(int array[], Index start, Index end) {
 
         if (start >= end) {
             return;
         }
         //pivot este end;
-        int i = start -1;
-        for (int j = start; j < end; ++j) {
+        Index i = start -1;
+        for (Index j = start; j < end; ++j) {
             if (array[j] < array[end]) {
                 swap(array[j],array[++i]);
             }
@@ -214,25 +1067,1803 @@ private:
 
 
 
-int main() {
+//usage: pregatire_marire [distribution] [n] [seed] [algorithm]
+//algorithms the driver can run, in the same order as ALGORITHM_NAMES
+enum SortAlgorithm {
+    ALG_INSERTION = 0,
+    ALG_SELECTION,
+    ALG_HEAP,
+    ALG_MERGE,
+    ALG_QUICK,
+    ALG_QUICK_THREE_WAY,
+    ALG_COUNTING,
+    ALG_MERGE_MULTIWAY,
+    ALG_INTRO,
+    ALG_RADIX,
+    ALG_MERGE_INPLACE,
+    ALG_BITONIC,
+    ALG_ODD_EVEN_MERGE,
+    ALG_AUTO,
+    ALG_COUNT
+};
 
-    int values[] = {8,7,9,2,3,1,10,5,4,6};
-    int n = size(values);
+const char* const ALGORITHM_NAMES[ALG_COUNT] = {
+    "insertion", "selection", "heap", "merge", "quick", "quick3", "counting", "merge-kway",
+    "intro", "radix", "merge-inplace", "bitonic", "odd-even-merge", "auto"
+};
 
+SortAlgorithm parseAlgorithm(const char* name) {
+    for (int a = 0; a < ALG_COUNT; ++a) {
+        if (strcmp(name, ALGORITHM_NAMES[a]) == 0) return static_cast<SortAlgorithm>(a);
+    }
+    return ALG_COUNT;
+}
 
-    CMergeSorter sorter0(values, n);
-    CHeapSorter sorter1(values , n);
-    CQuickSorter sorter2(values , n);
-    CSorter sorter3(values,n);
+//sorts by building a histogram of the keys, meant for key ranges that are small
+//compared to n (the histogram should stay in cache)
+constexpr size_t COUNTING_PARALLEL_THRESHOLD = size_t(1) << 20;
+//every worker keeps a histogram of the whole key range, 512 KiB of counters at this
+//size whatever n is; wider ranges are sorted by comparison instead
+constexpr size_t COUNTING_MAX_RANGE = size_t(1) << 16;
 
-    cout<<"Initial array:\n";
-    sorter3.print();
+class CCountingSorter : public CSorter {
+public:
+    CCountingSorter(const int input[], int n): CSorter(input, n) {}
 
-    sorter3.insertionSort();
+    void countingSort() {
+        sortInPlace(data, size);
+    }
 
-    cout<<"Final array:\n";
-    sorter3.print();
-    cout<< endl;
+    //rewrites the keys straight from the histogram; key ranges too wide for one go to
+    //introsort
+    static void sortInPlace(int array[], size_t n) {
+        if (n <= 1) return;
+        int lo, hi;
+        findRange(array, n, lo, hi);
+        const size_t range = static_cast<size_t>(int64_t(hi) - lo) + 1;
+        if (range > COUNTING_MAX_RANGE) {
+            CQuickSorter::introSort(array, static_cast<Index>(n));
+            return;
+        }
+
+        const size_t workers = workerCount(n, COUNTING_PARALLEL_THRESHOLD);
+        vector<vector<size_t>> counts(workers);
+        countSlices(array, n, lo, range, counts);
+
+        size_t out = 0;
+        for (size_t v = 0; v < range; ++v) {
+            size_t c = 0;
+            for (auto &hist : counts) c += hist[v];
+            fill(array + out, array + out + c, static_cast<int>(lo + int64_t(v)));
+            out += c;
+        }
+    }
+
+    //stable scatter of (key, payload) pairs into separate output arrays, every
+    //thread scatters its own slice from its own offsets. Key ranges too wide for one
+    //histogram are ordered by a stable sort of the positions instead
+    template<typename T>
+    static void scatterStable(const int keys[], const T payload[], size_t n, int outKeys[], T outPayload[]) {
+        if (n == 0) return;
+        int lo, hi;
+        findRange(keys, n, lo, hi);
+        const size_t range = static_cast<size_t>(int64_t(hi) - lo) + 1;
+        if (range > COUNTING_MAX_RANGE) {
+            vector<size_t> order(n);
+            for (size_t k = 0; k < n; ++k) order[k] = k;
+            stable_sort(order.begin(), order.end(), [keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+            for (size_t k = 0; k < n; ++k) {
+                outKeys[k] = keys[order[k]];
+                outPayload[k] = payload[order[k]];
+            }
+            return;
+        }
+
+        const size_t workers = workerCount(n, COUNTING_PARALLEL_THRESHOLD);
+        vector<vector<size_t>> counts(workers);
+        countSlices(keys, n, lo, range, counts);
+
+        //offsets ordered by key first and slice second keep equal keys in input order
+        size_t sum = 0;
+        for (size_t v = 0; v < range; ++v) {
+            for (auto &hist : counts) {
+                size_t c = hist[v];
+                hist[v] = sum;
+                sum += c;
+            }
+        }
 
+        runParallel(workers, [&](size_t w) {
+            vector<size_t> &offset = counts[w];
+            for (size_t k = n * w / workers; k < n * (w + 1) / workers; ++k) {
+                size_t dst = offset[static_cast<size_t>(int64_t(keys[k]) - lo)]++;
+                outKeys[dst] = keys[k];
+                outPayload[dst] = payload[k];
+            }
+        });
+    }
+
+private:
+    //single pass over the data, branch-free so it vectorizes
+    static void findRange(const int array[], size_t n, int &lo, int &hi) {
+        lo = array[0];
+        hi = array[0];
+        for (size_t k = 1; k < n; ++k) {
+            lo = min(lo, array[k]);
+            hi = max(hi, array[k]);
+        }
+    }
+
+    //counts[w] becomes the histogram of slice w
+    static void countSlices(const int array[], size_t n, int lo, size_t range, vector<vector<size_t>> &counts) {
+        const size_t workers = counts.size();
+        runParallel(workers, [&](size_t w) {
+            vector<size_t> hist(range, 0);
+            for (size_t k = n * w / workers; k < n * (w + 1) / workers; ++k) {
+                ++hist[static_cast<size_t>(int64_t(array[k]) - lo)];
+            }
+            counts[w] = move(hist);
+        });
+    }
+};
+
+// -----------------------------
+// Radix sorting
+// -----------------------------
+constexpr int RADIX_BITS = 8;
+constexpr size_t RADIX_BUCKETS = size_t(1) << RADIX_BITS;
+constexpr size_t RADIX_PARALLEL_THRESHOLD = size_t(1) << 18;
+//buckets up to this size are finished by insertion sort instead of more passes
+constexpr size_t RADIX_INSERTION_MAX = 64;
+//bytes the scatter collects per bucket before writing them out, one cache line
+constexpr size_t RADIX_LINE_BYTES = 64;
+
+//hybrid radix sort for 8 to 64-bit integer keys and for float and double keys. A parallel MSD pass on the highest
+//byte that differs between the smallest and the largest key splits the input into 256
+//buckets: every thread counts its slice, the counts are prefix summed bucket by bucket
+//across the threads, and every thread scatters its slice through one cache line of
+//buffer per bucket, so the writes leave in full lines. The buckets are independent
+//afterwards and small enough to stay in cache, so each is finished by LSD passes on
+//the lower bytes on a single thread, largest buckets first. Floating-point keys are
+//sorted by their bits in IEEE 754 total order: -NaN, -inf, negative numbers, -0.0,
+//+0.0, positive numbers, +inf, +NaN, so every input has one sorted order
+class CRadixSorter : public CSorter {
+public:
+    CRadixSorter(const int input[], int n): CSorter(input, n) {}
+
+    void radixSort() {
+        sortInPlace(data, static_cast<size_t>(size));
+    }
+
+    //the scratch space comes from the arena and is given back on return
+    template<typename T>
+    static void sortInPlace(T keys[], size_t n, CArena &arena = threadArena()) {
+        if (n <= RADIX_INSERTION_MAX) {
+            insertionSort(keys, n);
+            return;
+        }
+        CArenaScope scope(arena);
+        sortInPlace(keys, n, arena.allocate<T>(n), arena);
+    }
+
+    //scratch needs room for n keys, the arena only holds the scatter buffers
+    template<typename T>
+    static void sortInPlace(T keys[], size_t n, T scratch[], CArena &arena = threadArena()) {
+        static_assert(is_integral_v<T> || is_same_v<T, float> || is_same_v<T, double>, "radix sort needs integer or IEEE keys");
+        if (n <= RADIX_INSERTION_MAX) {
+            insertionSort(keys, n);
+            return;
+        }
+        CArenaScope scope(arena);
+
+        const size_t workers = workerCount(n, RADIX_PARALLEL_THRESHOLD);
+        using Key = decltype(toKey(T{}));
+        vector<Key> lows(workers), highs(workers);
+        vector<array<size_t, RADIX_BUCKETS>> offsets(workers);
+
+        //bits above the highest one that differs are the same in every key
+        runParallel(workers, [&](size_t w) {
+            auto [first, last] = slice(n, workers, w);
+            lows[w] = highs[w] = toKey(keys[first]);
+            for (size_t k = first; k < last; ++k) {
+                lows[w] = min(lows[w], toKey(keys[k]));
+                highs[w] = max(highs[w], toKey(keys[k]));
+            }
+        });
+        const auto differing = static_cast<Key>(*min_element(lows.begin(), lows.end()) ^ *max_element(highs.begin(), highs.end()));
+        if (differing == 0) return;
+        const int msdShift = max(static_cast<int>(bit_width(differing)) - RADIX_BITS, 0);
+
+        runParallel(workers, [&](size_t w) {
+            auto [first, last] = slice(n, workers, w);
+            auto &count = offsets[w];
+            count.fill(0);
+            for (size_t k = first; k < last; ++k) ++count[digit(keys[k], msdShift)];
+        });
+
+        //bucket b of thread w starts after bucket b of threads 0..w-1 and all smaller buckets
+        array<size_t, RADIX_BUCKETS + 1> bucketStart{};
+        size_t sum = 0;
+        for (size_t b = 0; b < RADIX_BUCKETS; ++b) {
+            bucketStart[b] = sum;
+            for (size_t w = 0; w < workers; ++w) {
+                size_t c = offsets[w][b];
+                offsets[w][b] = sum;
+                sum += c;
+            }
+        }
+        bucketStart[RADIX_BUCKETS] = n;
+
+        SLine<T>* lines = arena.allocate<SLine<T>>(workers * RADIX_BUCKETS);
+        runParallel(workers, [&](size_t w) {
+            auto [first, last] = slice(n, workers, w);
+            scatterByLines(keys + first, last - first, msdShift, offsets[w], scratch, lines + w * RADIX_BUCKETS);
+        });
+
+        array<size_t, RADIX_BUCKETS> order;
+        for (size_t b = 0; b < RADIX_BUCKETS; ++b) order[b] = b;
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return bucketStart[a + 1] - bucketStart[a] > bucketStart[b + 1] - bucketStart[b];
+        });
+
+        atomic<size_t> next{0};
+        runParallel(workers, [&](size_t) {
+            for (size_t k; (k = next.fetch_add(1, memory_order_relaxed)) < RADIX_BUCKETS; ) {
+                const size_t b = order[k];
+                const size_t start = bucketStart[b];
+                finishBucket(scratch + start, keys + start, bucketStart[b + 1] - start, msdShift);
+            }
+        });
+    }
+
+private:
+    //one cache line of keys waiting to be written to their bucket
+    template<typename T>
+    struct alignas(RADIX_LINE_BYTES) SLine {
+        T keys[RADIX_LINE_BYTES / sizeof(T)];
+    };
+
+    //keys compared as unsigned, with the sign bit flipped for signed types. A float
+    //with the sign bit clear gets it set, one with the sign bit set has all bits
+    //flipped, so larger negative numbers come first and NaNs go to the ends
+    template<typename T>
+    static auto toKey(T v) {
+        if constexpr (is_floating_point_v<T>) {
+            using Bits = conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+            const auto bits = bit_cast<Bits>(v);
+            constexpr Bits sign = Bits(1) << (sizeof(T) * 8 - 1);
+            return (bits & sign) ? Bits(~bits) : Bits(bits | sign);
+        } else {
+            auto key = static_cast<make_unsigned_t<T>>(v);
+            if constexpr (is_signed_v<T>) key ^= make_unsigned_t<T>(1) << (sizeof(T) * 8 - 1);
+            return key;
+        }
+    }
+
+    template<typename T>
+    static size_t digit(T v, int shift) {
+        return static_cast<size_t>(toKey(v) >> shift) & (RADIX_BUCKETS - 1);
+    }
+
+    static pair<size_t, size_t> slice(size_t n, size_t workers, size_t w) {
+        return {n * w / workers, n * (w + 1) / workers};
+    }
+
+    template<typename T>
+    static void insertionSort(T keys[], size_t n) {
+        for (size_t i = 1; i < n; ++i) {
+            T key = keys[i];
+            size_t j = i;
+            for (; j > 0 && toKey(key) < toKey(keys[j - 1]); --j) keys[j] = keys[j - 1];
+            keys[j] = key;
+        }
+    }
+
+    //writes src[k] to dst[offset[digit]++], collecting a cache line per bucket first in
+    //lines, which has RADIX_BUCKETS entries
+    template<typename T>
+    static void scatterByLines(const T src[], size_t n, int shift, array<size_t, RADIX_BUCKETS> &offset, T dst[], SLine<T> lines[]) {
+        constexpr size_t LINE = RADIX_LINE_BYTES / sizeof(T);
+        array<size_t, RADIX_BUCKETS> filled{};
+
+        for (size_t k = 0; k < n; ++k) {
+            const size_t b = digit(src[k], shift);
+            lines[b].keys[filled[b]++] = src[k];
+            if (filled[b] == LINE) {
+                copy(lines[b].keys, lines[b].keys + LINE, dst + offset[b]);
+                offset[b] += LINE;
+                filled[b] = 0;
+            }
+        }
+        for (size_t b = 0; b < RADIX_BUCKETS; ++b) {
+            copy(lines[b].keys, lines[b].keys + filled[b], dst + offset[b]);
+            offset[b] += filled[b];
+        }
+    }
+
+    //sorts the n keys in src by the bits below msdShift (all higher bits are equal)
+    //and leaves them in dst
+    template<typename T>
+    static void finishBucket(T src[], T dst[], size_t n, int msdShift) {
+        if (n <= RADIX_INSERTION_MAX) {
+            copy(src, src + n, dst);
+            insertionSort(dst, n);
+            return;
+        }
+
+        T* from = src;
+        T* to = dst;
+        for (int shift = 0; shift < msdShift; shift += RADIX_BITS) {
+            array<size_t, RADIX_BUCKETS> offset{};
+            for (size_t k = 0; k < n; ++k) ++offset[digit(from[k], shift)];
+            //every key has the same digit here, nothing to move
+            if (offset[digit(from[0], shift)] == n) continue;
+
+            size_t sum = 0;
+            for (auto &o : offset) {
+                size_t c = o;
+                o = sum;
+                sum += c;
+            }
+            for (size_t k = 0; k < n; ++k) to[offset[digit(from[k], shift)]++] = from[k];
+            swap(from, to);
+        }
+        if (from != dst) copy(from, from + n, dst);
+    }
+};
+
+// -----------------------------
+// String sorting
+// -----------------------------
+//string bytes cached in every key, the low byte of the key holds how many there are
+constexpr size_t STRING_KEY_CHARS = 7;
+constexpr size_t STRING_INSERTION_MAX = 16;
+//radix sort groups below this size go to multikey quicksort
+constexpr size_t STRING_RADIX_MIN = 64;
+constexpr size_t STRING_PARALLEL_THRESHOLD = size_t(1) << 16;
+//bucket 0 holds the strings that end before the byte, bucket 1 + c the byte c
+constexpr size_t STRING_BUCKETS = 257;
+
+//sorts string views in byte order (the order of string_view::compare) by moving the
+//views, never the strings. Each view is paired with a cached 64-bit key: the next
+//STRING_KEY_CHARS bytes from the current depth, big-endian, with the number of them
+//the string has in the low byte. Keys compare like the bytes they hold, so the sorts
+//run over a contiguous array of keys and only read the strings themselves once per
+//STRING_KEY_CHARS bytes of depth, to refresh the keys of a group that is still tied
+class CStringSorter {
+public:
+    //multikey quicksort (Bentley and Sedgewick) on whole keys: a three-way partition
+    //by key, and the part equal to the pivot moves on to the next key
+    static void multikeyQuickSort(span<string_view> strings, CArena &arena = threadArena()) {
+        CArenaScope scope(arena);
+        SItem* items = load(strings, arena);
+        multikeyQuickSort(items, strings.size(), 0);
+        store(items, strings);
+    }
+
+    //MSD radix sort on one byte of the cached keys per pass. Large inputs are split on
+    //the first byte that differs, and the buckets are then sorted by worker threads,
+    //largest first
+    static void radixSort(span<string_view> strings, CArena &arena = threadArena()) {
+        CArenaScope scope(arena);
+        const size_t n = strings.size();
+        SItem* items = load(strings, arena);
+        SItem* scratch = arena.allocate<SItem>(n);
+
+        const size_t workers = workerCount(n, STRING_PARALLEL_THRESHOLD);
+        if (workers == 1) {
+            radixSort(items, scratch, n, 0, 0);
+            store(items, strings);
+            return;
+        }
+
+        //bytes every string shares are skipped, they would leave a single bucket
+        size_t depth = 0;
+        size_t level = 0;
+        array<size_t, STRING_BUCKETS + 1> bounds;
+        for (;; ++level) {
+            if (level == STRING_KEY_CHARS) {
+                depth += STRING_KEY_CHARS;
+                level = 0;
+                refreshKeys(items, n, depth);
+            }
+            distribute(items, scratch, n, level, bounds);
+            const size_t first = digit(items[0], level);
+            if (bounds[first + 1] - bounds[first] != n) break;
+            //every string ended, they are all equal
+            if (first == 0) {
+                store(items, strings);
+                return;
+            }
+        }
+
+        array<size_t, STRING_BUCKETS> order;
+        for (size_t b = 0; b < STRING_BUCKETS; ++b) order[b] = b;
+        sort(order.begin() + 1, order.end(), [&](size_t a, size_t b) {
+            return bounds[a + 1] - bounds[a] > bounds[b + 1] - bounds[b];
+        });
+
+        atomic<size_t> next{1};
+        runParallel(workers, [&](size_t) {
+            for (size_t k; (k = next.fetch_add(1, memory_order_relaxed)) < STRING_BUCKETS; ) {
+                const size_t b = order[k];
+                radixSort(items + bounds[b], scratch + bounds[b], bounds[b + 1] - bounds[b], depth, level + 1);
+            }
+        });
+        store(items, strings);
+    }
+
+private:
+    struct SItem {
+        uint64_t key;
+        string_view view;
+    };
+
+    static uint64_t keyAt(string_view s, size_t depth) {
+        const size_t count = s.size() > depth ? min(s.size() - depth, STRING_KEY_CHARS) : 0;
+        uint64_t key = count;
+        for (size_t i = 0; i < count; ++i) {
+            key |= uint64_t(static_cast<unsigned char>(s[depth + i])) << (56 - 8 * i);
+        }
+        return key;
+    }
+
+    //the tie is broken past the key only when both strings filled it
+    static bool less(const SItem &a, const SItem &b, size_t depth) {
+        if (a.key != b.key) return a.key < b.key;
+        return (a.key & 0xff) == STRING_KEY_CHARS
+            && a.view.substr(depth + STRING_KEY_CHARS) < b.view.substr(depth + STRING_KEY_CHARS);
+    }
+
+    static SItem* load(span<const string_view> strings, CArena &arena) {
+        SItem* items = arena.allocate<SItem>(strings.size());
+        for (size_t k = 0; k < strings.size(); ++k) items[k] = SItem{keyAt(strings[k], 0), strings[k]};
+        return items;
+    }
+
+    static void store(const SItem items[], span<string_view> strings) {
+        for (size_t k = 0; k < strings.size(); ++k) strings[k] = items[k].view;
+    }
+
+    static void refreshKeys(SItem items[], size_t n, size_t depth) {
+        for (size_t k = 0; k < n; ++k) items[k].key = keyAt(items[k].view, depth);
+    }
+
+    //items hold keys for depth; level is the byte of the key to sort by
+    static size_t digit(const SItem &item, size_t level) {
+        if ((item.key & 0xff) <= level) return 0;
+        return 1 + static_cast<size_t>(item.key >> (56 - 8 * level) & 0xff);
+    }
+
+    static void insertionSort(SItem items[], size_t n, size_t depth) {
+        for (size_t i = 1; i < n; ++i) {
+            SItem item = items[i];
+            size_t j = i;
+            for (; j > 0 && less(item, items[j - 1], depth); --j) items[j] = items[j - 1];
+            items[j] = item;
+        }
+    }
+
+    static void multikeyQuickSort(SItem items[], size_t n, size_t depth) {
+        while (n > STRING_INSERTION_MAX) {
+            uint64_t a = items[0].key, b = items[n / 2].key, c = items[n - 1].key;
+            const uint64_t pivot = max(min(a, b), min(max(a, b), c));
+
+            size_t lt = 0, i = 0, gt = n;
+            while (i < gt) {
+                if (items[i].key < pivot) swap(items[lt++], items[i++]);
+                else if (items[i].key > pivot) swap(items[i], items[--gt]);
+                else ++i;
+            }
+            multikeyQuickSort(items, lt, depth);
+            multikeyQuickSort(items + gt, n - gt, depth);
+
+            //strings that ended inside the key are equal
+            if ((pivot & 0xff) != STRING_KEY_CHARS) return;
+            items += lt;
+            n = gt - lt;
+            depth += STRING_KEY_CHARS;
+            refreshKeys(items, n, depth);
+        }
+        insertionSort(items, n, depth);
+    }
+
+    //stable counting pass on byte level of the keys, through scratch; bounds[b] is
+    //where bucket b starts and bounds[STRING_BUCKETS] == n
+    static void distribute(SItem items[], SItem scratch[], size_t n, size_t level, array<size_t, STRING_BUCKETS + 1> &bounds) {
+        array<size_t, STRING_BUCKETS> offset{};
+        for (size_t k = 0; k < n; ++k) ++offset[digit(items[k], level)];
+        size_t sum = 0;
+        for (size_t b = 0; b < STRING_BUCKETS; ++b) {
+            bounds[b] = sum;
+            sum += offset[b];
+            offset[b] = bounds[b];
+        }
+        bounds[STRING_BUCKETS] = n;
+        //everything in one bucket, nothing to move
+        const size_t first = digit(items[0], level);
+        if (bounds[first + 1] - bounds[first] == n) return;
+
+        for (size_t k = 0; k < n; ++k) scratch[offset[digit(items[k], level)]++] = items[k];
+        copy(scratch, scratch + n, items);
+    }
+
+    static void radixSort(SItem items[], SItem scratch[], size_t n, size_t depth, size_t level) {
+        if (level == STRING_KEY_CHARS) {
+            depth += STRING_KEY_CHARS;
+            level = 0;
+            refreshKeys(items, n, depth);
+        }
+        if (n < STRING_RADIX_MIN) {
+            multikeyQuickSort(items, n, depth);
+            return;
+        }
+
+        array<size_t, STRING_BUCKETS + 1> bounds;
+        distribute(items, scratch, n, level, bounds);
+        for (size_t b = 1; b < STRING_BUCKETS; ++b) {
+            const size_t size = bounds[b + 1] - bounds[b];
+            if (size > 1) radixSort(items + bounds[b], scratch + bounds[b], size, depth, level + 1);
+        }
+    }
+};
+
+// -----------------------------
+// Segmented sorting
+// -----------------------------
+//kernel choice per segment length
+constexpr size_t SEGMENT_NETWORK_MAX = 16;
+constexpr size_t SEGMENT_INSERTION_MAX = 64;
+constexpr size_t SEGMENT_PARALLEL_THRESHOLD = size_t(1) << 16;
+
+//NETWORK_KERNELS[n] sorts n ints with the compile-time network for n
+using NetworkKernel = void (*)(int[]);
+
+template<size_t... N>
+constexpr array<NetworkKernel, sizeof...(N)> makeNetworkKernels(index_sequence<N...>) {
+    return {static_cast<NetworkKernel>(&CFixedSorter<int, N>::sort)...};
+}
+
+inline constexpr auto NETWORK_KERNELS = makeNetworkKernels(make_index_sequence<SEGMENT_NETWORK_MAX + 1>{});
+
+//sorts many small independent segments stored back to back, in place and without a
+//sorter object per segment. Segment s is data[offsets[s] .. offsets[s + 1]), so
+//offsets holds segments + 1 ascending entries
+class CSegmentedSorter {
+public:
+    static void sortSegments(int data[], const size_t offsets[], size_t segments) {
+        if (segments == 0) return;
+        const size_t total = offsets[segments] - offsets[0];
+        const size_t workers = min(workerCount(total, SEGMENT_PARALLEL_THRESHOLD), segments);
+
+        //every worker gets a contiguous range of segments holding about the same
+        //number of elements, found by binary search in the offsets
+        runParallel(workers, [&](size_t w) {
+            size_t first = segmentAt(offsets, segments, offsets[0] + total * w / workers);
+            size_t last = segmentAt(offsets, segments, offsets[0] + total * (w + 1) / workers);
+            if (w + 1 == workers) last = segments;
+            for (size_t seg = first; seg < last; ++seg) {
+                sortSegment(data + offsets[seg], offsets[seg + 1] - offsets[seg]);
+            }
+        });
+    }
+
+    static void sortSegment(int first[], size_t n) {
+        if (n <= 1) return;
+        if (n <= SEGMENT_NETWORK_MAX) {
+            NETWORK_KERNELS[n](first);
+        } else if (n <= SEGMENT_INSERTION_MAX) {
+            CSorter::insertionSort(first, static_cast<Index>(n));
+        } else {
+            CQuickSorter::introSort(first, static_cast<Index>(n));
+        }
+    }
+
+private:
+    //first segment starting at or after element position pos
+    static size_t segmentAt(const size_t offsets[], size_t segments, size_t pos) {
+        return static_cast<size_t>(lower_bound(offsets, offsets + segments, pos) - offsets);
+    }
+};
+
+// -----------------------------
+// Sorting networks over whole arrays
+// -----------------------------
+//ints per compare-exchange block, a multiple of every SIMD width, so the block loop
+//vectorizes whatever the target
+constexpr Index NETWORK_LANES = 16;
+//stages whose comparators stay inside aligned blocks of this many ints are run one
+//block at a time, while the block is in L1
+constexpr Index NETWORK_BLOCK = Index(1) << 12;
+constexpr size_t NETWORK_PARALLEL_THRESHOLD = size_t(1) << 16;
+
+//data-oblivious sorts: Batcher's bitonic sort and odd-even merge sort run a network of
+//compare-exchanges that depends only on the length, so every input of that length
+//touches memory in the same order. Lengths are padded to a power of two with INT_MAX
+//in an arena copy. Every stage compares disjoint pairs between contiguous runs with
+//branch-free min/max, which the compiler turns into SIMD. The workers split every
+//stage and meet at a barrier before the next one, except for the stages that stay
+//inside a NETWORK_BLOCK block, which every worker runs for its own blocks in one go
+class CNetworkSorter : public CSorter {
+public:
+    CNetworkSorter(const int input[], int n): CSorter(input, n) {}
+
+    void bitonicSort() {
+        bitonicSort(data, size);
+    }
+
+    void oddEvenMergeSort() {
+        oddEvenMergeSort(data, size);
+    }
+
+    static void bitonicSort(int array[], Index n, CArena &arena = threadArena()) {
+        sortPadded(array, n, arena, &bitonicNetwork);
+    }
+
+    static void oddEvenMergeSort(int array[], Index n, CArena &arena = threadArena()) {
+        sortPadded(array, n, arena, &oddEvenNetwork);
+    }
+
+    //lo[t] becomes the smaller and hi[t] the larger of the two, for every t < count; a
+    //descending compare-exchange passes them the other way round
+    static void compareExchange(int lo[], int hi[], Index count) {
+        Index t = 0;
+        for (; t + NETWORK_LANES <= count; t += NETWORK_LANES) {
+            int low[NETWORK_LANES], high[NETWORK_LANES];
+            for (Index v = 0; v < NETWORK_LANES; ++v) {
+                low[v] = min(lo[t + v], hi[t + v]);
+                high[v] = max(lo[t + v], hi[t + v]);
+            }
+            copy(low, low + NETWORK_LANES, lo + t);
+            copy(high, high + NETWORK_LANES, hi + t);
+        }
+        for (; t < count; ++t) {
+            const int a = lo[t], b = hi[t];
+            lo[t] = min(a, b);
+            hi[t] = max(a, b);
+        }
+    }
+
+private:
+    using Network = void (*)(int[], Index);
+
+    static void sortPadded(int array[], Index n, CArena &arena, Network network) {
+        if (n <= 1) return;
+        const auto padded = static_cast<Index>(bit_ceil(static_cast<size_t>(n)));
+        if (padded == n) {
+            network(array, n);
+            return;
+        }
+        CArenaScope scope(arena);
+        int* keys = arena.allocate<int>(static_cast<size_t>(padded));
+        copy(array, array + n, keys);
+        fill(keys + n, keys + padded, INT_MAX);
+        network(keys, padded);
+        copy(keys, keys + n, array);
+    }
+
+    //whole blocks of the power of two n for worker w
+    static pair<Index, Index> slice(Index n, Index block, size_t workers, size_t w) {
+        const auto blocks = static_cast<size_t>(n / block);
+        return {static_cast<Index>(blocks * w / workers) * block, static_cast<Index>(blocks * (w + 1) / workers) * block};
+    }
+
+    //stage (k, j) for the lower indices in [first, last): a with bit j clear against
+    //a + j, ascending where bit k of a is clear
+    static void bitonicStage(int keys[], Index k, Index j, Index first, Index last) {
+        switch (j) {
+            case 1: return bitonicShortStage<1>(keys, k, first, last);
+            case 2: return bitonicShortStage<2>(keys, k, first, last);
+            case 4: return bitonicShortStage<4>(keys, k, first, last);
+            case 8: return bitonicShortStage<8>(keys, k, first, last);
+            default: break;
+        }
+        for (Index s = first & ~(2 * j - 1); s < last; s += 2 * j) {
+            const Index from = max(s, first);
+            const Index to = min(s + j, last);
+            if (from >= to) continue;
+            if ((s & k) == 0) {
+                compareExchange(keys + from, keys + from + j, to - from);
+            } else {
+                compareExchange(keys + from + j, keys + from, to - from);
+            }
+        }
+    }
+
+    //stage (k, J) with runs shorter than NETWORK_LANES, for [first, last) aligned to 2J:
+    //a fixed-width kernel per run, with the direction picked by pointer instead of a
+    //branch
+    template<Index J>
+    static void bitonicShortStage(int keys[], Index k, Index first, Index last) {
+        for (Index s = first; s < last; s += 2 * J) {
+            int low[J], high[J];
+            for (Index t = 0; t < J; ++t) {
+                low[t] = min(keys[s + t], keys[s + J + t]);
+                high[t] = max(keys[s + t], keys[s + J + t]);
+            }
+            const bool ascending = (s & k) == 0;
+            copy(ascending ? low : high, (ascending ? low : high) + J, keys + s);
+            copy(ascending ? high : low, (ascending ? high : low) + J, keys + s + J);
+        }
+    }
+
+    //stage (p, k) of n keys for the lower indices in [first, last): a in the runs
+    //[j, j + k) with j = k % p + 2km against a + k, where both are in the same block
+    //of 2p; always ascending
+    static void oddEvenStage(int keys[], Index n, Index p, Index k, Index first, Index last) {
+        switch (k) {
+            case 1: return oddEvenShortStage<1>(keys, n, p, first, last);
+            case 2: return oddEvenShortStage<2>(keys, n, p, first, last);
+            case 4: return oddEvenShortStage<4>(keys, n, p, first, last);
+            case 8: return oddEvenShortStage<8>(keys, n, p, first, last);
+            default: break;
+        }
+        const Index offset = k % p;
+        const Index skip = first > offset ? (first - offset) / (2 * k) : 0;
+        for (Index j = offset + 2 * k * skip; j < last && j + k < n; j += 2 * k) {
+            const Index end = min({j + k, last, n - k});
+            for (Index a = max(j, first); a < end; ) {
+                const Index blockEnd = (a / (2 * p) + 1) * 2 * p;
+                if (a + k >= blockEnd) {
+                    a = blockEnd;
+                    continue;
+                }
+                const Index run = min(end, blockEnd - k) - a;
+                compareExchange(keys + a, keys + a + k, run);
+                a += run;
+            }
+        }
+    }
+
+    //stage (p, K) with runs shorter than NETWORK_LANES, for first aligned to 2K: the
+    //runs start at K % p + 2Km, and the one that ends K before a 2p boundary would
+    //reach into the next block
+    template<Index K>
+    static void oddEvenShortStage(int keys[], Index n, Index p, Index first, Index last) {
+        for (Index s = first + K % p; s < last && s + K < n; s += 2 * K) {
+            if ((s + K) % (2 * p) == 0) continue;
+            int low[K], high[K];
+            for (Index t = 0; t < K; ++t) {
+                low[t] = min(keys[s + t], keys[s + K + t]);
+                high[t] = max(keys[s + t], keys[s + K + t]);
+            }
+            copy(low, low + K, keys + s);
+            copy(high, high + K, keys + s + K);
+        }
+    }
+
+    static void bitonicNetwork(int keys[], Index n) {
+        const Index block = min(n, NETWORK_BLOCK);
+        const size_t workers = workerCount(static_cast<size_t>(n), NETWORK_PARALLEL_THRESHOLD);
+        barrier sync(static_cast<ptrdiff_t>(workers));
+        runParallel(workers, [&](size_t w) {
+            auto [first, last] = slice(n, block, workers, w);
+            for (Index b = first; b < last; b += block) {
+                for (Index k = 2; k <= block; k *= 2) {
+                    for (Index j = k / 2; j > 0; j /= 2) bitonicStage(keys, k, j, b, b + block);
+                }
+            }
+            for (Index k = 2 * block; k <= n; k *= 2) {
+                for (Index j = k / 2; j >= block; j /= 2) {
+                    sync.arrive_and_wait();
+                    bitonicStage(keys, k, j, first, last);
+                }
+                sync.arrive_and_wait();
+                for (Index b = first; b < last; b += block) {
+                    for (Index j = block / 2; j > 0; j /= 2) bitonicStage(keys, k, j, b, b + block);
+                }
+            }
+        });
+    }
+
+    static void oddEvenNetwork(int keys[], Index n) {
+        const Index block = min(n, NETWORK_BLOCK);
+        const size_t workers = workerCount(static_cast<size_t>(n), NETWORK_PARALLEL_THRESHOLD);
+        barrier sync(static_cast<ptrdiff_t>(workers));
+        runParallel(workers, [&](size_t w) {
+            auto [first, last] = slice(n, block, workers, w);
+            for (Index b = first; b < last; b += block) {
+                for (Index p = 1; p < block; p *= 2) {
+                    for (Index k = p; k > 0; k /= 2) oddEvenStage(keys + b, block, p, k, 0, block);
+                }
+            }
+            for (Index p = block; p < n; p *= 2) {
+                for (Index k = p; k > 0; k /= 2) {
+                    sync.arrive_and_wait();
+                    oddEvenStage(keys, n, p, k, first, last);
+                }
+            }
+        });
+    }
+};
+
+// -----------------------------
+// Instrumentation
+// -----------------------------
+//when set, sortAuto writes every decision here as one line of key=value pairs
+ostream* decisionLog = nullptr;
+
+// -----------------------------
+// Automatic algorithm selection
+// -----------------------------
+constexpr int AUTO_INSERTION_MAX = 32;
+constexpr size_t AUTO_SAMPLE_SIZE = 1024;
+//sampled runs at most n / AUTO_PRESORTED_DIVISOR count as presorted
+constexpr double AUTO_PRESORTED_DIVISOR = 64.0;
+//counting sort when the key range is at most this and at most twice n
+constexpr int64_t AUTO_COUNTING_MAX_RANGE = int64_t(1) << 16;
+//radix sort from this size on for wider ranges; below about 512 keys its histogram
+//passes cost more than introsort
+constexpr size_t AUTO_RADIX_MIN_SIZE = 1024;
+
+struct SInputProfile {
+    size_t n = 0;
+    size_t sampledPairs = 0;
+    size_t descents = 0;        //sampled pairs with array[k] > array[k+1]
+    double runsEstimate = 0.0;  //descents scaled to the whole array, plus one
+    int lo = 0;
+    int hi = 0;
+    double duplicateRatio = 0.0;  //sampled keys equal to their sorted neighbour
+};
+
+struct SAutoDecision {
+    SortAlgorithm engine;
+    const char* reason;
+    SInputProfile profile;
+};
+
+class CAutoSorter : public CSorter {
+public:
+    CAutoSorter(const int input[], int n): CSorter(input, n) {}
+
+    SAutoDecision sortAuto() {
+        return sortAuto(data, size);
+    }
+
+    static SAutoDecision sortAuto(int array[], Index n, CArena &arena = threadArena()) {
+        SAutoDecision decision = decide(profile(array, n));
+        logDecision(decision);
+
+        switch (decision.engine) {
+            case ALG_INSERTION:
+                CSorter::insertionSort(array, n);
+                break;
+            case ALG_COUNTING:
+                CCountingSorter::sortInPlace(array, static_cast<size_t>(n));
+                break;
+            case ALG_MERGE: {
+                CArenaScope scope(arena);
+                CMergeSorter::mergeSort(array, n, arena.allocate<int>(static_cast<size_t>(n / 2)));
+                break;
+            }
+            case ALG_RADIX:
+                CRadixSorter::sortInPlace(array, static_cast<size_t>(n), arena);
+                break;
+            default:
+                CQuickSorter::introSort(array, n);
+                break;
+        }
+        return decision;
+    }
+
+    //exact key range, runs and duplicates estimated from evenly spaced samples
+    static SInputProfile profile(const int array[], Index n) {
+        SInputProfile p;
+        p.n = static_cast<size_t>(n);
+        if (n <= 0) return p;
+
+        p.lo = array[0];
+        p.hi = array[0];
+        for (Index k = 1; k < n; ++k) {
+            p.lo = min(p.lo, array[k]);
+            p.hi = max(p.hi, array[k]);
+        }
+        if (n == 1) return p;
+
+        const size_t pairs = static_cast<size_t>(n) - 1;
+        const size_t samples = min(pairs, AUTO_SAMPLE_SIZE);
+        vector<int> keys(samples);
+        for (size_t s = 0; s < samples; ++s) {
+            size_t k = s * pairs / samples;
+            if (array[k] > array[k + 1]) ++p.descents;
+            keys[s] = array[k];
+        }
+        p.sampledPairs = samples;
+        p.runsEstimate = 1.0 + static_cast<double>(p.descents) * static_cast<double>(pairs) / static_cast<double>(samples);
+
+        sort(keys.begin(), keys.end());
+        size_t equal = 0;
+        for (size_t s = 1; s < samples; ++s) {
+            if (keys[s] == keys[s - 1]) ++equal;
+        }
+        p.duplicateRatio = static_cast<double>(equal) / static_cast<double>(samples);
+        return p;
+    }
+
+    static SAutoDecision decide(const SInputProfile &p) {
+        const int64_t range = int64_t(p.hi) - p.lo + 1;
+        if (p.n <= static_cast<size_t>(AUTO_INSERTION_MAX)) {
+            return {ALG_INSERTION, "tiny input", p};
+        }
+        if (p.descents == 0 && p.sampledPairs == p.n - 1) {
+            return {ALG_INSERTION, "already in order", p};
+        }
+        if (range <= AUTO_COUNTING_MAX_RANGE && range <= 2 * static_cast<int64_t>(p.n)) {
+            return {ALG_COUNTING, "small key range", p};
+        }
+        if (p.runsEstimate <= static_cast<double>(p.n) / AUTO_PRESORTED_DIVISOR) {
+            return {ALG_MERGE, "few runs", p};
+        }
+        if (p.n >= AUTO_RADIX_MIN_SIZE) {
+            return {ALG_RADIX, "large input, wide key range", p};
+        }
+        return {ALG_INTRO, "general input", p};
+    }
+
+private:
+    static void logDecision(const SAutoDecision &d) {
+        if (!decisionLog) return;
+        *decisionLog << "sortAuto n=" << d.profile.n
+                     << " runs~" << d.profile.runsEstimate
+                     << " range=" << (int64_t(d.profile.hi) - d.profile.lo + 1)
+                     << " duplicates~" << d.profile.duplicateRatio
+                     << " engine=" << ALGORITHM_NAMES[d.engine]
+                     << " reason=\"" << d.reason << "\"" << endl;
+    }
+};
+
+// -----------------------------
+// Sorting caller-owned memory
+// -----------------------------
+//sorts values in place with the given algorithm. Nothing is copied in or out, so the
+//span can cover a vector, a stack array or a memory-mapped file of any length; merge
+//and radix sort take their scratch space from the arena and give it back on return,
+//every other engine runs without allocating more than its histograms
+void sortSpan(SortAlgorithm algorithm, span<int> values, CArena &arena = threadArena()) {
+    CArenaScope scope(arena);
+    int* array = values.data();
+    const auto n = static_cast<Index>(values.size());
+    switch (algorithm) {
+        case ALG_SELECTION:
+            CSorter::selectionSort(array, n);
+            break;
+        case ALG_HEAP:
+            CHeapSorter::heapSort(array, n);
+            break;
+        case ALG_MERGE:
+            CMergeSorter::mergeSort(array, n, arena.allocate<int>(values.size() / 2));
+            break;
+        case ALG_QUICK:
+            CQuickSorter::quickSort(array, n, PART_LOMUTO);
+            break;
+        case ALG_QUICK_THREE_WAY:
+            CQuickSorter::quickSort(array, n, PART_THREE_WAY);
+            break;
+        case ALG_COUNTING:
+            CCountingSorter::sortInPlace(array, values.size());
+            break;
+        case ALG_MERGE_MULTIWAY:
+            CMergeSorter::mergeSortMultiway(array, n, arena.allocate<int>(values.size()));
+            break;
+        case ALG_INTRO:
+            CQuickSorter::introSort(array, n);
+            break;
+        case ALG_RADIX:
+            CRadixSorter::sortInPlace(array, values.size(), arena);
+            break;
+        case ALG_MERGE_INPLACE:
+            CMergeSorter::mergeSortInPlace(array, n, arena.allocate<int>(INPLACE_MERGE_BUFFER));
+            break;
+        case ALG_BITONIC:
+            CNetworkSorter::bitonicSort(array, n, arena);
+            break;
+        case ALG_ODD_EVEN_MERGE:
+            CNetworkSorter::oddEvenMergeSort(array, n, arena);
+            break;
+        case ALG_AUTO:
+            CAutoSorter::sortAuto(array, n, arena);
+            break;
+        case ALG_INSERTION:
+        default:
+            CSorter::insertionSort(array, n);
+            break;
+    }
+}
+
+// -----------------------------
+// Incremental sorting
+// -----------------------------
+//re-sorts values that were in order before the entries at the indices in changed were
+//overwritten; changed may be in any order and hold repeats. Only the d changed values
+//are sorted, so this takes O(n + d log d) instead of a full sort
+void resortChanged(span<int> values, span<const Index> changed, CArena &arena = threadArena()) {
+    CArenaScope scope(arena);
+    Index* indices = arena.allocate<Index>(changed.size());
+    copy(changed.begin(), changed.end(), indices);
+    sort(indices, indices + changed.size());
+    const Index count = unique(indices, indices + changed.size()) - indices;
+    CMergeSorter::resortChanged(values.data(), static_cast<Index>(values.size()), indices, count,
+        arena.allocate<int>(static_cast<size_t>(count)));
+}
+
+//re-sorts values whose first sorted entries are in order and whose remaining entries
+//are new, for example appended ones; O(n + d log d) for d new entries
+void resortTail(span<int> values, size_t sorted, CArena &arena = threadArena()) {
+    CArenaScope scope(arena);
+    const size_t count = values.size() - min(sorted, values.size());
+    CMergeSorter::mergeTail(values.data(), static_cast<Index>(values.size()), static_cast<Index>(values.size() - count),
+        arena.allocate<int>(count));
+}
+
+// -----------------------------
+// Verification and benchmarks
+// -----------------------------
+//engines that go quadratic on some distribution (the quick sorts pivot on the last
+//key, so sorted input is their worst case) only get small inputs
+bool isQuadratic(SortAlgorithm algorithm) {
+    return algorithm == ALG_INSERTION || algorithm == ALG_SELECTION
+        || algorithm == ALG_QUICK || algorithm == ALG_QUICK_THREE_WAY;
+}
+
+//n strings "/data/items/<value>" for the values of a distribution; the shared prefix
+//is longer than one cached key of the string sorter
+vector<string> makeStringKeys(DistKind kind, uint64_t seed, size_t n) {
+    vector<int> values(n);
+    CInputGenerator(kind, seed, 0, static_cast<int>(4 * n)).fill(values.data(), n);
+    vector<string> strings(n);
+    for (size_t k = 0; k < n; ++k) strings[k] = "/data/items/" + to_string(values[k]);
+    return strings;
+}
+
+//doubles spread over [-1e6, 1e6], the float and double radix sort inputs
+vector<double> makeRealKeys(uint64_t seed, size_t n) {
+    SXoshiro256 rng(seed);
+    vector<double> keys(n);
+    for (auto &key : keys) key = (static_cast<double>(rng.next() >> 11) * 0x1.0p-53 - 0.5) * 2e6;
+    return keys;
+}
+
+//checks every engine against std::sort on every distribution, for sizes around the
+//insertion, network and parallel thresholds; prints the failures and returns their count
+int verifyAll() {
+    const size_t sizes[] = {0, 1, 2, 3, 15, 16, 17, 31, 32, 33, 100, 1000, 4097, 100000, size_t(1) << 21};
+    const int ranges[][2] = {{-50, 50}, {-1000000, 1000000}};
+    int failures = 0;
+    int checks = 0;
+
+    for (int a = 0; a < ALG_COUNT; ++a) {
+        const auto algorithm = static_cast<SortAlgorithm>(a);
+        for (int d = 0; d < DIST_COUNT; ++d) {
+            for (size_t n : sizes) {
+                if (isQuadratic(algorithm) && n > 4097) continue;
+                for (auto &range : ranges) {
+                    //inputs large enough for the parallel paths get a single seed
+                    const uint64_t seeds = n > 100000 ? 1 : 3;
+                    for (uint64_t seed = 1; seed <= seeds; ++seed) {
+                        vector<int> values(n);
+                        CInputGenerator(static_cast<DistKind>(d), seed, range[0], range[1]).fill(values.data(), n);
+                        vector<int> expected = values;
+                        sort(expected.begin(), expected.end());
+
+                        sortSpan(algorithm, values);
+                        ++checks;
+                        if (values != expected) {
+                            ++failures;
+                            cout << "FAIL " << ALGORITHM_NAMES[a] << " " << DIST_NAMES[d] << " n=" << n
+                                 << " range=" << range[0] << ".." << range[1] << " seed=" << seed << endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //radix sort on the other key widths, over their full range
+    SXoshiro256 rng(11);
+    for (size_t n : {size_t(1000), size_t(1) << 21}) {
+        vector<int64_t> wide(n);
+        vector<uint64_t> wideUnsigned(n);
+        vector<uint32_t> narrowUnsigned(n);
+        for (size_t k = 0; k < n; ++k) {
+            wideUnsigned[k] = rng.next();
+            wide[k] = static_cast<int64_t>(rng.next());
+            narrowUnsigned[k] = static_cast<uint32_t>(rng.next());
+        }
+        bool ok = true;
+        auto check = [&ok](auto &keys) {
+            auto expected = keys;
+            sort(expected.begin(), expected.end());
+            CRadixSorter::sortInPlace(keys.data(), keys.size());
+            ok = ok && keys == expected;
+        };
+        check(wide);
+        check(wideUnsigned);
+        check(narrowUnsigned);
+        ++checks;
+        if (!ok) {
+            ++failures;
+            cout << "FAIL radix wide keys n=" << n << endl;
+        }
+    }
+
+    //floating-point keys from random bits, so every NaN, infinity and subnormal shows
+    //up, and from a plain range with both zeros; the order has to be std::strong_order
+    for (size_t n : {size_t(1000), size_t(1) << 21}) {
+        vector<double> doubles = makeRealKeys(13, n);
+        vector<float> floats(n);
+        for (size_t k = 0; k < n; ++k) {
+            if (k % 2 == 1) doubles[k] = bit_cast<double>(rng.next());
+            floats[k] = k % 3 == 1 ? bit_cast<float>(static_cast<uint32_t>(rng.next())) : static_cast<float>(doubles[k]);
+        }
+        doubles[0] = -0.0;
+        doubles[1] = 0.0;
+        bool ok = true;
+        auto check = [&ok](auto &keys) {
+            auto expected = keys;
+            sort(expected.begin(), expected.end(), [](auto a, auto b) { return strong_order(a, b) < 0; });
+            CRadixSorter::sortInPlace(keys.data(), keys.size());
+            ok = ok && memcmp(keys.data(), expected.data(), keys.size() * sizeof(keys[0])) == 0;
+        };
+        check(doubles);
+        check(floats);
+        ++checks;
+        if (!ok) {
+            ++failures;
+            cout << "FAIL radix floating-point keys n=" << n << endl;
+        }
+    }
+
+    //strings with shared prefixes, and random bytes with embedded zeros where some
+    //strings are prefixes of others
+    for (size_t n : {size_t(0), size_t(1), size_t(100), size_t(5000), size_t(1) << 18}) {
+        for (int d = 0; d < DIST_COUNT; ++d) {
+            vector<string> owned = makeStringKeys(static_cast<DistKind>(d), 5, n);
+            for (size_t k = 0; k < n; k += 3) {
+                const size_t length = rng.next() % 24;
+                owned[k].assign(length, '\0');
+                for (auto &c : owned[k]) c = static_cast<char>(rng.next() % 4 == 0 ? 0 : rng.next());
+                if (k > 0 && rng.next() % 2 == 0) owned[k] = owned[k - 1].substr(0, owned[k - 1].size() / 2);
+            }
+            vector<string_view> expected(owned.begin(), owned.end());
+            sort(expected.begin(), expected.end());
+            vector<string_view> byQuickSort(owned.begin(), owned.end());
+            vector<string_view> byRadix = byQuickSort;
+            CStringSorter::multikeyQuickSort(byQuickSort);
+            CStringSorter::radixSort(byRadix);
+            ++checks;
+            if (byQuickSort != expected || byRadix != expected) {
+                ++failures;
+                cout << "FAIL strings " << DIST_NAMES[d] << " n=" << n << endl;
+            }
+        }
+    }
+
+    //segments of every length from 0 to 100, back to back
+    vector<size_t> offsets{0};
+    for (size_t len = 0; offsets.size() < 2000; len = (len + 7) % 101) offsets.push_back(offsets.back() + len);
+    vector<int> values(offsets.back());
+    CInputGenerator(DIST_UNIFORM, 7, -1000, 1000).fill(values.data(), values.size());
+    vector<int> expected = values;
+    for (size_t seg = 0; seg + 1 < offsets.size(); ++seg) {
+        sort(expected.begin() + static_cast<Index>(offsets[seg]), expected.begin() + static_cast<Index>(offsets[seg + 1]));
+    }
+    CSegmentedSorter::sortSegments(values.data(), offsets.data(), offsets.size() - 1);
+    ++checks;
+    if (values != expected) {
+        ++failures;
+        cout << "FAIL segmented" << endl;
+    }
+
+    //incremental re-sorts of sorted inputs with some entries overwritten, at random
+    //indices (in any order, with repeats) and at the end
+    for (size_t n : {size_t(1), size_t(17), size_t(1000), size_t(100000)}) {
+        for (size_t count : {size_t(0), size_t(1), n / 100, n / 10, n}) {
+            vector<int> original(n);
+            CInputGenerator(DIST_UNIFORM, 9, -1000, 1000).fill(original.data(), n);
+            sort(original.begin(), original.end());
+
+            vector<int> changedValues = original;
+            vector<int> tailValues = original;
+            vector<Index> changed(count);
+            for (size_t c = 0; c < count; ++c) {
+                changed[c] = static_cast<Index>(rng.next() % n);
+                changedValues[changed[c]] = static_cast<int>(rng.next() % 2001) - 1000;
+                tailValues[n - 1 - c] = static_cast<int>(rng.next() % 2001) - 1000;
+            }
+            vector<int> expectedChanged = changedValues;
+            vector<int> expectedTail = tailValues;
+            sort(expectedChanged.begin(), expectedChanged.end());
+            sort(expectedTail.begin(), expectedTail.end());
+
+            resortChanged(changedValues, changed);
+            resortTail(tailValues, n - count);
+            ++checks;
+            if (changedValues != expectedChanged || tailValues != expectedTail) {
+                ++failures;
+                cout << "FAIL resort n=" << n << " changed=" << count << endl;
+            }
+        }
+    }
+
+    cout << checks << " checks, " << failures << " failures" << endl;
+    return failures;
+}
+
+struct SBenchResult {
+    string engine;
+    string distribution;
+    size_t n;
+    double ms;
+};
+
+//fastest of a few runs, so one preempted run does not count
+constexpr int BENCH_REPEATS = 3;
+constexpr size_t BENCH_SIZE = size_t(1) << 20;
+constexpr size_t BENCH_QUADRATIC_SIZE = size_t(1) << 13;
+//differences below this are timer and scheduler noise, whatever the tolerance
+constexpr double BENCH_NOISE_MS = 1.0;
+//percent above the baseline allowed when none is given, the same as BENCH_TOLERANCE in CMakeLists.txt
+constexpr double BENCH_TOLERANCE_PERCENT = 50.0;
+//the incremental re-sort benchmark changes one entry in this many
+constexpr size_t RESORT_BENCH_DIVISOR = 100;
+
+//fastest of BENCH_REPEATS runs of sortKeys on fresh copies of input; the copy and
+//the scratch space of every run reuse the same arena pages
+template<typename T, typename F>
+double timeSort(const vector<T> &input, CArena &arena, F sortKeys) {
+    CArenaScope scope(arena);
+    double best = 0.0;
+    ArenaVector<T> values{CArenaAllocator<T>(arena)};
+    for (int r = 0; r < BENCH_REPEATS; ++r) {
+        values.assign(input.begin(), input.end());
+        auto start = chrono::steady_clock::now();
+        sortKeys(span<T>(values));
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (r == 0 || ms < best) best = ms;
+    }
+    return best;
+}
+
+//prints r and returns whether it is slower than its baseline entry allows
+bool reportBench(const SBenchResult &r, const vector<SBenchResult> &baseline, double tolerance) {
+    bool regressed = false;
+    cout << r.engine << " " << r.distribution << " " << r.n << " " << r.ms << " ms";
+    for (auto &b : baseline) {
+        if (b.engine != r.engine || b.distribution != r.distribution || b.n != r.n) continue;
+        if (r.ms > b.ms * (1.0 + tolerance) + BENCH_NOISE_MS) {
+            regressed = true;
+            cout << "  REGRESSION, baseline " << b.ms << " ms";
+        }
+        break;
+    }
+    cout << endl;
+    return regressed;
+}
+
+//time against extra memory of the stable merge engines on the uniform input, the
+//memory being the peak of a fresh arena during one sort; not part of the baseline
+void reportMergeMemory(const vector<SBenchResult> &results) {
+    vector<int> input(BENCH_SIZE);
+    CInputGenerator(DIST_UNIFORM, 42, 0, static_cast<int>(4 * BENCH_SIZE)).fill(input.data(), BENCH_SIZE);
+    cout << "merge engines on " << BENCH_SIZE << " uniform ints (" << BENCH_SIZE * sizeof(int) << " bytes):" << endl;
+    for (SortAlgorithm algorithm : {ALG_MERGE, ALG_MERGE_MULTIWAY, ALG_MERGE_INPLACE}) {
+        CArena probe;
+        vector<int> values = input;
+        sortSpan(algorithm, values, probe);
+        for (auto &r : results) {
+            if (r.engine != ALGORITHM_NAMES[algorithm] || r.distribution != DIST_NAMES[DIST_UNIFORM]) continue;
+            cout << "  " << r.engine << " " << r.ms << " ms, "
+                 << static_cast<double>(BENCH_SIZE) / r.ms / 1000.0 << " M ints/s, "
+                 << probe.peakBytes() << " bytes of scratch" << endl;
+        }
+    }
+}
+
+//times every engine on every distribution with fixed seeds, radix sort on 64-bit and
+//floating-point keys, an incremental re-sort with 1% of the entries changed, and both
+//string engines on every distribution. Without a baseline file the results are written to it; with one, every time
+//above baseline * (1 + tolerance) + BENCH_NOISE_MS is reported as a regression and
+//counted in the return value
+int benchmark(const char* baselinePath, double tolerance) {
+    vector<SBenchResult> baseline;
+    ifstream in(baselinePath);
+    for (SBenchResult b; in >> b.engine >> b.distribution >> b.n >> b.ms; ) baseline.push_back(b);
+    in.close();
+
+    CArena arena;
+    vector<SBenchResult> results;
+    for (int a = 0; a < ALG_COUNT; ++a) {
+        const auto algorithm = static_cast<SortAlgorithm>(a);
+        const size_t n = isQuadratic(algorithm) ? BENCH_QUADRATIC_SIZE : BENCH_SIZE;
+        for (int d = 0; d < DIST_COUNT; ++d) {
+            vector<int> input(n);
+            CInputGenerator(static_cast<DistKind>(d), 42, 0, static_cast<int>(4 * n)).fill(input.data(), n);
+            double ms = timeSort(input, arena, [algorithm, &arena](span<int> values) { sortSpan(algorithm, values, arena); });
+            results.push_back(SBenchResult{ALGORITHM_NAMES[a], DIST_NAMES[d], n, ms});
+        }
+    }
+
+    vector<int64_t> wide(BENCH_SIZE);
+    SXoshiro256 rng(42);
+    for (auto &key : wide) key = static_cast<int64_t>(rng.next());
+    double ms = timeSort(wide, arena, [&arena](span<int64_t> values) { CRadixSorter::sortInPlace(values.data(), values.size(), arena); });
+    results.push_back(SBenchResult{"radix64", DIST_NAMES[DIST_UNIFORM], BENCH_SIZE, ms});
+
+    vector<double> reals = makeRealKeys(42, BENCH_SIZE);
+    vector<float> narrowReals(reals.begin(), reals.end());
+    ms = timeSort(reals, arena, [&arena](span<double> values) { CRadixSorter::sortInPlace(values.data(), values.size(), arena); });
+    results.push_back(SBenchResult{"radix-double", DIST_NAMES[DIST_UNIFORM], BENCH_SIZE, ms});
+    ms = timeSort(narrowReals, arena, [&arena](span<float> values) { CRadixSorter::sortInPlace(values.data(), values.size(), arena); });
+    results.push_back(SBenchResult{"radix-float", DIST_NAMES[DIST_UNIFORM], BENCH_SIZE, ms});
+
+    //a sorted array with one entry in RESORT_BENCH_DIVISOR overwritten, re-sorted
+    vector<int> resortInput(BENCH_SIZE);
+    CInputGenerator(DIST_UNIFORM, 42, 0, static_cast<int>(4 * BENCH_SIZE)).fill(resortInput.data(), BENCH_SIZE);
+    sort(resortInput.begin(), resortInput.end());
+    vector<Index> changed(BENCH_SIZE / RESORT_BENCH_DIVISOR);
+    for (auto &index : changed) {
+        index = static_cast<Index>(rng.next() % BENCH_SIZE);
+        resortInput[index] = static_cast<int>(rng.next() % (4 * BENCH_SIZE));
+    }
+    ms = timeSort(resortInput, arena, [&arena, &changed](span<int> values) { resortChanged(values, changed, arena); });
+    results.push_back(SBenchResult{"resort", DIST_NAMES[DIST_UNIFORM], BENCH_SIZE, ms});
+
+    for (int d = 0; d < DIST_COUNT; ++d) {
+        vector<string> owned = makeStringKeys(static_cast<DistKind>(d), 42, BENCH_SIZE);
+        vector<string_view> strings(owned.begin(), owned.end());
+        ms = timeSort(strings, arena, [&arena](span<string_view> values) { CStringSorter::multikeyQuickSort(values, arena); });
+        results.push_back(SBenchResult{"string-mkqs", DIST_NAMES[d], BENCH_SIZE, ms});
+        ms = timeSort(strings, arena, [&arena](span<string_view> values) { CStringSorter::radixSort(values, arena); });
+        results.push_back(SBenchResult{"string-radix", DIST_NAMES[d], BENCH_SIZE, ms});
+    }
+
+    int regressions = 0;
+    for (auto &r : results) {
+        if (reportBench(r, baseline, tolerance)) ++regressions;
+    }
+    reportMergeMemory(results);
+
+    if (baseline.empty()) {
+        ofstream out(baselinePath);
+        for (auto &r : results) out << r.engine << " " << r.distribution << " " << r.n << " " << r.ms << "\n";
+        cout << "baseline written to " << baselinePath << endl;
+    } else {
+        cout << regressions << " regressions above " << tolerance * 100.0 << "%" << endl;
+    }
+    return regressions;
+}
+
+// -----------------------------
+// Sorting files
+// -----------------------------
+//text inputs below this many bytes are parsed on one thread
+constexpr size_t PARSE_PARALLEL_THRESHOLD = size_t(1) << 22;
+constexpr size_t WRITE_BUFFER_BYTES = size_t(1) << 20;
+//"-2147483648"
+constexpr size_t INT_TEXT_MAX = 11;
+
+//a whole file mapped into memory. A writable mapping is shared with the file, so
+//whatever is written to it ends up in the file without another copy. Without mmap the
+//file is read into a buffer instead, and a writable one is written back on close
+class CMappedFile {
+public:
+    CMappedFile(const char* path, bool writable) {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = open(path, writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            length = static_cast<size_t>(info.st_size);
+            opened = true;
+            if (length > 0) {
+                void* p = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    opened = false;
+                } else {
+                    bytes = static_cast<char*>(p);
+                    madvise(p, length, MADV_SEQUENTIAL);
+                }
+            }
+        }
+        close(fd);
+#else
+        ifstream in(path, ios::binary);
+        if (!in) return;
+        fallback.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        bytes = fallback.data();
+        length = fallback.size();
+        opened = true;
+        if (writable) writeBackPath = path;
+#endif
+    }
+
+    ~CMappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (bytes) munmap(bytes, length);
+#else
+        if (!writeBackPath.empty()) ofstream(writeBackPath, ios::binary).write(fallback.data(), static_cast<streamsize>(length));
+#endif
+    }
+
+    //whether both paths name the same file, so that sorting one in place sorts the other
+    static bool sameFile(const char* a, const char* b) {
+#if defined(__unix__) || defined(__APPLE__)
+        struct stat first, second;
+        return stat(a, &first) == 0 && stat(b, &second) == 0 && first.st_dev == second.st_dev && first.st_ino == second.st_ino;
+#else
+        return strcmp(a, b) == 0;
+#endif
+    }
+
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return opened; }
+    [[nodiscard]] char* data() const { return bytes; }
+    [[nodiscard]] size_t size() const { return length; }
+
+private:
+    char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#if !defined(__unix__) && !defined(__APPLE__)
+    vector<char> fallback;
+    string writeBackPath;
+#endif
+};
+
+inline bool isSeparator(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+struct SParsedInts {
+    int* values;
+    size_t count;
+    //offset of the first token that is not an int, length when there is none
+    size_t errorOffset;
+};
+
+//parses whitespace separated ints into memory from the arena. The text is cut into
+//one chunk per worker at separators; a first pass counts the tokens of every chunk so
+//the second can parse each chunk straight to its place in the output
+SParsedInts parseInts(const char text[], size_t length, CArena &arena) {
+    const size_t workers = workerCount(length, PARSE_PARALLEL_THRESHOLD);
+    vector<size_t> bounds(workers + 1, length);
+    bounds[0] = 0;
+    for (size_t w = 1; w < workers; ++w) {
+        size_t b = max(length * w / workers, bounds[w - 1]);
+        while (b < length && !isSeparator(text[b])) ++b;
+        bounds[w] = b;
+    }
+
+    vector<size_t> first(workers + 1, 0);
+    runParallel(workers, [&](size_t w) {
+        size_t tokens = 0;
+        for (size_t k = bounds[w]; k < bounds[w + 1]; ++k) {
+            if (!isSeparator(text[k]) && (k == bounds[w] || isSeparator(text[k - 1]))) ++tokens;
+        }
+        first[w + 1] = tokens;
+    });
+    for (size_t w = 0; w < workers; ++w) first[w + 1] += first[w];
+
+    SParsedInts parsed{arena.allocate<int>(first[workers]), first[workers], length};
+    vector<size_t> errors(workers, length);
+    runParallel(workers, [&](size_t w) {
+        const char* p = text + bounds[w];
+        const char* end = text + bounds[w + 1];
+        int* out = parsed.values + first[w];
+        while (true) {
+            while (p < end && isSeparator(*p)) ++p;
+            if (p == end) break;
+            auto [next, ec] = from_chars(p, end, *out);
+            if (ec != errc() || (next < end && !isSeparator(*next))) {
+                errors[w] = static_cast<size_t>(p - text);
+                return;
+            }
+            ++out;
+            p = next;
+        }
+    });
+    parsed.errorOffset = *min_element(errors.begin(), errors.end());
+    return parsed;
+}
+
+//one value per line through a buffer of WRITE_BUFFER_BYTES, false on a write error
+bool writeInts(FILE* out, const int values[], size_t n) {
+    vector<char> buffer(WRITE_BUFFER_BYTES);
+    size_t used = 0;
+    for (size_t k = 0; k < n; ++k) {
+        if (used + INT_TEXT_MAX + 1 > buffer.size()) {
+            if (fwrite(buffer.data(), 1, used, out) != used) return false;
+            used = 0;
+        }
+        char* end = to_chars(buffer.data() + used, buffer.data() + buffer.size(), values[k]).ptr;
+        *end++ = '\n';
+        used = static_cast<size_t>(end - buffer.data());
+    }
+    return fwrite(buffer.data(), 1, used, out) == used;
+}
+
+double elapsedMs(chrono::steady_clock::time_point since) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - since).count();
+}
+
+//binary half of sortFile. The input is written to the output file once, then the output
+//is mapped shared and sorted in place, so the sorted pages are the file; when both are
+//the same file it is sorted where it is. Standard output cannot be mapped, so for "-"
+//the ints are copied into the arena, sorted there and written out
+int sortBinaryFile(SortAlgorithm algorithm, const char* inputPath, const char* outputPath) {
+    auto start = chrono::steady_clock::now();
+    const bool toStdout = strcmp(outputPath, "-") == 0;
+    const bool inPlace = !toStdout && CMappedFile::sameFile(inputPath, outputPath);
+    CArena arena;
+    span<int> values;
+    size_t bytes = 0;
+    {
+        CMappedFile input(inputPath, false);
+        if (!input.isOpen()) {
+            cerr << "Could not read " << inputPath << endl;
+            return 1;
+        }
+        bytes = input.size();
+        if (bytes % sizeof(int) != 0) {
+            cerr << inputPath << " is not a whole number of " << sizeof(int) << "-byte ints" << endl;
+            return 1;
+        }
+        if (toStdout) {
+            values = span<int>(arena.allocate<int>(bytes / sizeof(int)), bytes / sizeof(int));
+            if (bytes > 0) memcpy(values.data(), input.data(), bytes);
+        } else if (!inPlace) {
+            FILE* out = fopen(outputPath, "wb");
+            bool copied = out != nullptr;
+            if (copied) copied = (bytes == 0 || fwrite(input.data(), 1, bytes, out) == bytes) & (fclose(out) == 0);
+            if (!copied) {
+                cerr << "Could not write " << outputPath << endl;
+                return 1;
+            }
+        }
+    }
+    const double copyMs = elapsedMs(start);
+
+    decisionLog = &clog;
+    double sortMs = 0.0;
+    start = chrono::steady_clock::now();
+    if (toStdout) {
+        sortSpan(algorithm, values, arena);
+        sortMs = elapsedMs(start);
+        start = chrono::steady_clock::now();
+        if (fwrite(values.data(), sizeof(int), values.size(), stdout) != values.size() || fflush(stdout) != 0) {
+            cerr << "Could not write " << outputPath << endl;
+            return 1;
+        }
+    } else {
+        CMappedFile output(outputPath, true);
+        if (!output.isOpen() || output.size() != bytes) {
+            cerr << "Could not map " << outputPath << endl;
+            return 1;
+        }
+        values = span<int>(reinterpret_cast<int*>(output.data()), bytes / sizeof(int));
+        sortSpan(algorithm, values, arena);
+        sortMs = elapsedMs(start);
+        start = chrono::steady_clock::now();
+    }
+    const double writeMs = elapsedMs(start);
+
+    cerr << bytes / sizeof(int) << " values, binary" << (inPlace ? " in place" : "") << ", " << ALGORITHM_NAMES[algorithm] << endl
+         << "copy  " << copyMs << " ms" << endl
+         << "sort  " << sortMs << " ms" << endl
+         << "write " << writeMs << " ms" << endl;
+    return 0;
+}
+
+//pregatire_marire --sort <algorithm> <input> <output> [--binary]
+//text files hold whitespace separated ints and are written one per line, binary files
+//hold native 32-bit ints (see sortBinaryFile). The output may be "-" for stdout. The
+//time of every phase goes to stderr
+int sortFile(int argc, char* argv[]) {
+    bool binary = false;
+    vector<const char*> args;
+    for (int k = 2; k < argc; ++k) {
+        if (strcmp(argv[k], "--binary") == 0) {
+            binary = true;
+        } else {
+            args.push_back(argv[k]);
+        }
+    }
+    const SortAlgorithm algorithm = args.size() == 3 ? parseAlgorithm(args[0]) : ALG_COUNT;
+    if (algorithm == ALG_COUNT) {
+        cerr << "usage: pregatire_marire --sort <algorithm> <input> <output> [--binary], algorithm one of:";
+        for (auto name : ALGORITHM_NAMES) cerr << " " << name;
+        cerr << endl;
+        return 1;
+    }
+    if (binary) return sortBinaryFile(algorithm, args[1], args[2]);
+
+    auto start = chrono::steady_clock::now();
+    CMappedFile input(args[1], false);
+    if (!input.isOpen()) {
+        cerr << "Could not read " << args[1] << endl;
+        return 1;
+    }
+    CArena arena;
+    SParsedInts parsed = parseInts(input.data(), input.size(), arena);
+    if (parsed.errorOffset < input.size()) {
+        cerr << args[1] << ": not an int at byte " << parsed.errorOffset << endl;
+        return 1;
+    }
+    span<int> values(parsed.values, parsed.count);
+    const double parseMs = elapsedMs(start);
+
+    decisionLog = &clog;
+    start = chrono::steady_clock::now();
+    sortSpan(algorithm, values, arena);
+    const double sortMs = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    const bool toStdout = strcmp(args[2], "-") == 0;
+    FILE* out = toStdout ? stdout : fopen(args[2], "wb");
+    bool written = out != nullptr;
+    if (written) {
+        written = writeInts(out, values.data(), values.size());
+        written = (toStdout ? fflush(out) : fclose(out)) == 0 && written;
+    }
+    if (!written) {
+        cerr << "Could not write " << args[2] << endl;
+        return 1;
+    }
+    const double writeMs = elapsedMs(start);
+
+    cerr << values.size() << " values, text, " << ALGORITHM_NAMES[algorithm] << endl
+         << "parse " << parseMs << " ms" << endl
+         << "sort  " << sortMs << " ms" << endl
+         << "write " << writeMs << " ms" << endl;
+    return 0;
+}
+
+void runAlgorithm(SortAlgorithm algorithm, int values[], int n) {
+    switch (algorithm) {
+        case ALG_SELECTION: {
+            CSorter sorter(values, n);
+            sorter.selectionSort();
+            sorter.print();
+            break;
+        }
+        case ALG_HEAP: {
+            CHeapSorter sorter(values, n);
+            sorter.heapSort();
+            sorter.print();
+            break;
+        }
+        case ALG_MERGE: {
+            CMergeSorter sorter(values, n);
+            sorter.mergeSort();
+            sorter.print();
+            break;
+        }
+        case ALG_QUICK:
+        case ALG_QUICK_THREE_WAY: {
+            CQuickSorter sorter(values, n, algorithm == ALG_QUICK ? PART_LOMUTO : PART_THREE_WAY);
+            sorter.quickSort();
+            sorter.print();
+            break;
+        }
+        case ALG_COUNTING: {
+            CCountingSorter sorter(values, n);
+            sorter.countingSort();
+            sorter.print();
+            break;
+        }
+        case ALG_MERGE_MULTIWAY: {
+            CMergeSorter sorter(values, n);
+            sorter.mergeSortMultiway();
+            sorter.print();
+            break;
+        }
+        case ALG_INTRO: {
+            CQuickSorter sorter(values, n);
+            sorter.introSort();
+            sorter.print();
+            break;
+        }
+        case ALG_RADIX: {
+            CRadixSorter sorter(values, n);
+            sorter.radixSort();
+            sorter.print();
+            break;
+        }
+        case ALG_MERGE_INPLACE: {
+            CMergeSorter sorter(values, n);
+            sorter.mergeSortInPlace();
+            sorter.print();
+            break;
+        }
+        case ALG_BITONIC: {
+            CNetworkSorter sorter(values, n);
+            sorter.bitonicSort();
+            sorter.print();
+            break;
+        }
+        case ALG_ODD_EVEN_MERGE: {
+            CNetworkSorter sorter(values, n);
+            sorter.oddEvenMergeSort();
+            sorter.print();
+            break;
+        }
+        case ALG_AUTO: {
+            CAutoSorter sorter(values, n);
+            sorter.sortAuto();
+            sorter.print();
+            break;
+        }
+        case ALG_INSERTION:
+        default: {
+            CSorter sorter(values, n);
+            sorter.insertionSort();
+            sorter.print();
+            break;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    //pregatire_marire --verify
+    //pregatire_marire --bench <baseline file> [tolerance percent]
+    //pregatire_marire --sort <algorithm> <input> <output> [--binary]
+    if (argc > 1 && strcmp(argv[1], "--sort") == 0) {
+        return sortFile(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--verify") == 0) {
+        return verifyAll() == 0 ? 0 : 1;
+    }
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0) {
+        double tolerance = (argc > 3 ? atof(argv[3]) : BENCH_TOLERANCE_PERCENT) / 100.0;
+        return benchmark(argv[2], tolerance) == 0 ? 0 : 1;
+    }
+
+    DistKind dist = DIST_UNIFORM;
+    int n = 10;
+    uint64_t seed = 42;
+
+    if (argc > 1) {
+        dist = parseDistribution(argv[1]);
+        if (dist == DIST_COUNT) {
+            cerr << "Unknown distribution \"" << argv[1] << "\", expected one of:";
+            for (auto name : DIST_NAMES) cerr << " " << name;
+            cerr << endl;
+            return 1;
+        }
+    }
+    if (argc > 2) n = min(max(atoi(argv[2]), 1), CONST_MAX_LENGTH);
+    if (argc > 3) seed = strtoull(argv[3], nullptr, 10);
+
+    SortAlgorithm algorithm = ALG_INSERTION;
+    if (argc > 4) {
+        algorithm = parseAlgorithm(argv[4]);
+        if (algorithm == ALG_COUNT) {
+            cerr << "Unknown algorithm \"" << argv[4] << "\", expected one of:";
+            for (auto name : ALGORITHM_NAMES) cerr << " " << name;
+            cerr << endl;
+            return 1;
+        }
+    }
+
+    int values[CONST_MAX_LENGTH];
+    //same value range as the visualizer, so its arrays can be reproduced here
+    CInputGenerator(dist, seed, 20, 419).fill(values, n);
+
+    cout << "Input: " << DIST_NAMES[dist] << ", n = " << n << ", seed = " << seed << endl;
+
+    decisionLog = &clog;
+
+    CSorter initial(values, n);
+    cout<<"Initial array:\n";
+    initial.print();
+
+    cout<<"Final array (" << ALGORITHM_NAMES[algorithm] << "):\n";
+    runAlgorithm(algorithm, values, n);
+    cout<< endl;
 
-}
\ No newline at end of file
+    return 0;
+}
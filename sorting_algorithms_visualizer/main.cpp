@@ -2,11 +2,29 @@
 #include <ctime>
 #include <random>
 #include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <numbers>
+#include <mutex>
+#include <string>
+#include <fstream>
 
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <bit>
+#include <new>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
 
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
@@ -18,9 +36,139 @@ constexpr int WINDOW_HEIGHT = 600;
 
 constexpr float LATERAL_MARGIN = 50.0f;
 constexpr float SPACE_BETWEEN_BARS = 2.0f;
-constexpr int CONST_MAX_LENGTH = 100;
 constexpr int NUMBER_OF_COLUMNS = 30;
+//array sizes the menu cycles through
+constexpr int ARRAY_SIZES[] = {NUMBER_OF_COLUMNS, 100, 1000, 10000, 100000, 1000000};
+constexpr int NUM_ARRAY_SIZES = 6;
 constexpr float DURATION = 1.0f;
+//frames per second while something animates; an idle window draws nothing
+constexpr unsigned int ANIMATION_FRAME_LIMIT = 60;
+
+// -----------------------------
+// Memory arenas
+// -----------------------------
+constexpr std::size_t ARENA_ALIGNMENT = 64;
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+//bump allocator for traces, sorter copies and merge scratch, same as in the practice
+//driver. Blocks start on huge page boundaries and use huge pages where the system
+//allows it, allocations are ARENA_ALIGNMENT aligned and only reset() frees anything.
+//After a reset the blocks are merged into one, so a recording slot that is reused for
+//sort after sort stops mapping memory once it has seen the largest one
+class CArena {
+public:
+    CArena() = default;
+    ~CArena() { release(); }
+
+    CArena(const CArena&) = delete;
+    CArena& operator=(const CArena&) = delete;
+
+    void* allocate(std::size_t bytes) {
+        bytes = (std::max<std::size_t>(bytes, 1) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+        //blocks after the current one are empty, they were reset
+        for (; current < blocks.size(); ++current) {
+            SBlock &b = blocks[current];
+            if (b.capacity - b.used >= bytes) return bump(b, bytes);
+        }
+        const std::size_t last = blocks.empty() ? 0 : blocks.back().capacity;
+        blocks.push_back(mapBlock(std::max({bytes, 2 * last, HUGE_PAGE_SIZE})));
+        current = blocks.size() - 1;
+        return bump(blocks.back(), bytes);
+    }
+
+    template<typename T>
+    T* allocate(std::size_t count) {
+        static_assert(alignof(T) <= ARENA_ALIGNMENT, "over-aligned type");
+        return static_cast<T*>(allocate(count * sizeof(T)));
+    }
+
+    void reset() {
+        if (blocks.size() > 1) {
+            std::size_t total = 0;
+            for (auto &b : blocks) total += b.capacity;
+            release();
+            blocks.push_back(mapBlock(total));
+        }
+        for (auto &b : blocks) b.used = 0;
+        current = 0;
+    }
+
+private:
+    struct SBlock {
+        char* base;
+        std::size_t capacity;
+        std::size_t used;
+    };
+
+    std::vector<SBlock> blocks;
+    std::size_t current = 0;
+
+    static void* bump(SBlock &b, std::size_t bytes) {
+        void* p = b.base + b.used;
+        b.used += bytes;
+        return p;
+    }
+
+    void release() {
+        for (auto &b : blocks) unmapBlock(b);
+        blocks.clear();
+        current = 0;
+    }
+
+    static SBlock mapBlock(std::size_t bytes) {
+        const std::size_t size = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#if defined(__unix__) || defined(__APPLE__)
+#ifdef MAP_HUGETLB
+        void* huge = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (huge != MAP_FAILED) return SBlock{static_cast<char*>(huge), size, 0};
+#endif
+        //no reserved huge pages: map one huge page more and trim to a huge page boundary
+        const std::size_t mapped = size + HUGE_PAGE_SIZE;
+        void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        char* first = static_cast<char*>(raw);
+        char* base = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(first) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+        if (base > first) munmap(first, static_cast<std::size_t>(base - first));
+        if (base + size < first + mapped) munmap(base + size, static_cast<std::size_t>(first + mapped - (base + size)));
+#ifdef MADV_HUGEPAGE
+        madvise(base, size, MADV_HUGEPAGE);
+#endif
+        return SBlock{base, size, 0};
+#else
+        return SBlock{static_cast<char*>(::operator new(size, std::align_val_t(HUGE_PAGE_SIZE))), size, 0};
+#endif
+    }
+
+    static void unmapBlock(const SBlock &b) {
+#if defined(__unix__) || defined(__APPLE__)
+        munmap(b.base, b.capacity);
+#else
+        ::operator delete(b.base, std::align_val_t(HUGE_PAGE_SIZE));
+#endif
+    }
+};
+
+//standard allocator over an arena, deallocate is a no-op until the arena is reset
+template<typename T>
+class CArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit CArenaAllocator(CArena &arena): arena(&arena) {}
+    template<typename U>
+    CArenaAllocator(const CArenaAllocator<U> &other): arena(other.arena) {}
+
+    T* allocate(std::size_t n) { return arena->allocate<T>(n); }
+    void deallocate(T*, std::size_t) {}
+
+    template<typename U>
+    bool operator==(const CArenaAllocator<U> &other) const { return arena == other.arena; }
+
+    CArena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, CArenaAllocator<T>>;
 
 // -----------------------------
 // Steps / Buffer (shared types)
@@ -39,29 +187,557 @@ struct SStep {
     int value; //eventually for overwrite
 };
 
+//receives the contents of a full SStepBuffer, see SStepBuffer::sink
+class CStepSink {
+public:
+    virtual ~CStepSink() = default;
+    virtual void flush(const SStep* steps, int count) = 0;
+};
+
+//steps live in fixed-size blocks that never move once allocated, so growing only
+//copies the block table (one pointer per 4096 steps), never the steps themselves
+constexpr int STEP_BLOCK_SHIFT = 12;
+constexpr int STEP_BLOCK_SIZE = 1 << STEP_BLOCK_SHIFT;
+constexpr int STEP_BLOCK_MASK = STEP_BLOCK_SIZE - 1;
+
 struct SStepBuffer {
-    SStep* data;
+    SStep** blocks;
+    int blockCount;
+    int blockTableCapacity;
     int size;
     int capacity;
+    //when set, a full block is handed to the sink and reused instead of adding blocks
+    CStepSink* sink;
+    //when set, blocks and block tables come from the arena and stay there until it is
+    //reset; set it before the first step
+    CArena* arena;
+
+    SStepBuffer(): blocks(nullptr), blockCount(0), blockTableCapacity(0), size(0), capacity(0), sink(nullptr), arena(nullptr) {}
+    ~SStepBuffer() {
+        if (arena) return;
+        for (int b = 0; b < blockCount; ++b) delete[] blocks[b];
+        delete[] blocks;
+    }
+
+    SStepBuffer(const SStepBuffer&) = delete;
+    SStepBuffer& operator=(const SStepBuffer&) = delete;
 
-    SStepBuffer(): data(nullptr), size(0), capacity(0) {}
-    ~SStepBuffer() { delete[] data; }
+    SStep& operator[](int k) { return blocks[k >> STEP_BLOCK_SHIFT][k & STEP_BLOCK_MASK]; }
+    const SStep& operator[](int k) const { return blocks[k >> STEP_BLOCK_SHIFT][k & STEP_BLOCK_MASK]; }
 
     void reserve(int newCapacity) {
-        if (newCapacity <= capacity) return;
-        auto* nd = new SStep[newCapacity];
-        for (int k = 0; k < size; ++k) nd[k] = data[k];
-        delete[] data;
-        data = nd;
-        capacity = newCapacity;
+        while (capacity < newCapacity) addBlock();
     }
 
     void push_back(const SStep &s) {
-        if (size == capacity) reserve(capacity == 0 ? 16 : capacity * 2);
-        data[size++] = s;
+        if (size == capacity) {
+            if (sink && size > 0) {
+                flushSink();
+            } else {
+                addBlock();
+            }
+        }
+        blocks[size >> STEP_BLOCK_SHIFT][size & STEP_BLOCK_MASK] = s;
+        ++size;
+    }
+
+    //hands the buffered steps to the sink; with a sink only the first block is used
+    void flushSink() {
+        if (!sink || size == 0) return;
+        sink->flush(blocks[0], size);
+        size = 0;
     }
 
     void clear() { size = 0; }
+
+    [[nodiscard]] std::size_t bytes() const {
+        return static_cast<std::size_t>(capacity) * sizeof(SStep)
+            + static_cast<std::size_t>(blockTableCapacity) * sizeof(SStep*);
+    }
+
+private:
+    void addBlock() {
+        if (blockCount == blockTableCapacity) {
+            int newTableCapacity = blockTableCapacity == 0 ? 16 : blockTableCapacity * 2;
+            auto** table = arena ? arena->allocate<SStep*>(newTableCapacity) : new SStep*[newTableCapacity];
+            std::copy(blocks, blocks + blockCount, table);
+            if (!arena) delete[] blocks;
+            blocks = table;
+            blockTableCapacity = newTableCapacity;
+        }
+        blocks[blockCount++] = arena ? arena->allocate<SStep>(STEP_BLOCK_SIZE) : new SStep[STEP_BLOCK_SIZE];
+        capacity += STEP_BLOCK_SIZE;
+    }
+};
+
+// -----------------------------
+// Profiling
+// -----------------------------
+//scoped zones exported as Chrome trace events (chrome://tracing or ui.perfetto.dev).
+//Every thread appends to its own buffer, so a zone never takes a lock; while
+//profiling is off a zone costs one relaxed load
+constexpr std::size_t PROFILE_MAX_EVENTS_PER_THREAD = std::size_t(1) << 21;
+
+struct SZoneEvent {
+    const char* name;
+    long long startNs;
+    long long durationNs;
+};
+
+struct SThreadZones {
+    int tid = 0;
+    std::string name;
+    std::vector<SZoneEvent> events;
+    long long dropped = 0;
+};
+
+class CProfiler {
+private:
+    static inline std::atomic<bool> enabled{false};
+    static inline std::mutex threadsMutex;
+    static inline std::vector<std::unique_ptr<SThreadZones>> threads;
+    static inline const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    //buffer of the calling thread; the lock is only taken once per thread
+    static SThreadZones& local() {
+        thread_local SThreadZones* zones = nullptr;
+        if (!zones) {
+            std::lock_guard<std::mutex> lock(threadsMutex);
+            threads.push_back(std::make_unique<SThreadZones>());
+            zones = threads.back().get();
+            zones->tid = static_cast<int>(threads.size());
+            zones->events.reserve(4096);
+        }
+        return *zones;
+    }
+
+public:
+    static void enable() { enabled.store(true, std::memory_order_relaxed); }
+    [[nodiscard]] static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] static long long now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    static void nameThread(const char* name) {
+        if (isEnabled()) local().name = name;
+    }
+
+    static void record(const char* name, long long startNs, long long endNs) {
+        SThreadZones &zones = local();
+        if (zones.events.size() == PROFILE_MAX_EVENTS_PER_THREAD) {
+            ++zones.dropped;
+            return;
+        }
+        zones.events.push_back(SZoneEvent{name, startNs, endNs - startNs});
+    }
+
+    //only once every profiled thread has finished
+    static bool writeChromeTrace(const char* path) {
+        std::ofstream out(path);
+        if (!out) return false;
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (auto &zones : threads) {
+            if (!zones->name.empty()) {
+                out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << zones->tid
+                    << ",\"args\":{\"name\":\"" << zones->name << "\"}}";
+                first = false;
+            }
+            for (auto &e : zones->events) {
+                out << (first ? "" : ",\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << zones->tid
+                    << std::fixed << std::setprecision(3)
+                    << ",\"ts\":" << static_cast<double>(e.startNs) / 1000.0
+                    << ",\"dur\":" << static_cast<double>(e.durationNs) / 1000.0 << "}";
+                first = false;
+            }
+            if (zones->dropped > 0) {
+                std::cerr << "profiler: thread " << zones->tid << " dropped " << zones->dropped << " zones" << std::endl;
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+};
+
+//times the enclosing scope while profiling is on; name must outlive the program
+//(a string literal)
+class CZone {
+private:
+    const char* name;
+    long long startNs;
+
+public:
+    explicit CZone(const char* name): name(name), startNs(CProfiler::isEnabled() ? CProfiler::now() : -1) {}
+    ~CZone() { end(); }
+
+    //closes the zone before the scope ends
+    void end() {
+        if (startNs >= 0) CProfiler::record(name, startNs, CProfiler::now());
+        startNs = -1;
+    }
+
+    CZone(const CZone&) = delete;
+    CZone& operator=(const CZone&) = delete;
+};
+
+// -----------------------------
+// Recording policies
+// -----------------------------
+//the sorters are templates over their recorder, so one implementation serves every
+//use: SStepBuffer keeps the steps for playback, SNullRecorder compiles away (an
+//unrecorded sort has no per-step branch left), SStepCounter only counts and
+//CTraceWriter streams the steps as text
+template<typename R>
+concept StepRecorder = requires(R &rec, const SStep &s) { rec.push_back(s); };
+
+struct SNullRecorder {
+    void push_back(const SStep&) {}
+};
+
+struct SStepCounter {
+    long long counts[4] = {0, 0, 0, 0};
+
+    void push_back(const SStep &s) { ++counts[s.kind]; }
+
+    [[nodiscard]] long long total() const { return counts[0] + counts[1] + counts[2] + counts[3]; }
+};
+
+//one "kind i j value" line per step
+class CTraceWriter {
+private:
+    std::ostream &out;
+
+public:
+    explicit CTraceWriter(std::ostream &out): out(out) {}
+
+    void push_back(const SStep &s) {
+        out << s.kind << ' ' << s.i << ' ' << s.j << ' ' << s.value << '\n';
+    }
+};
+
+//reads a trace written by CTraceWriter into out, false on a malformed line
+bool readTrace(std::istream &in, SStepBuffer &out) {
+    int kind = 0;
+    SStep s{};
+    while (in >> kind >> s.i >> s.j >> s.value) {
+        if (kind < ACT_COMPARE || kind > ACT_HIGHLIGHT) return false;
+        s.kind = static_cast<ActionKind>(kind);
+        out.push_back(s);
+    }
+    return in.eof();
+}
+
+// -----------------------------
+// Asynchronous recording
+// -----------------------------
+//a batch is one full SStepBuffer block
+constexpr int STEP_BATCH_SIZE = STEP_BLOCK_SIZE;
+constexpr std::size_t STEP_RING_BATCHES = 16;
+
+struct SStepBatch {
+    int count = 0;
+    SStep steps[STEP_BATCH_SIZE];
+};
+
+//thrown out of the sorter on the producer thread when the recording is cancelled
+struct SRecordingCancelled {};
+
+//bounded single-producer / single-consumer queue of step batches. The producer
+//only advances head and the consumer only advances tail, so no locks are needed;
+//a full ring makes the producer wait (back-pressure)
+class CStepRing : public CStepSink {
+private:
+    SStepBatch slots[STEP_RING_BATCHES];
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+    std::atomic<long long> produced{0};
+    std::atomic<bool> closed{false};
+    std::atomic<bool> cancelled{false};
+
+public:
+    //producer side
+    void flush(const SStep* steps, int count) override {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        while (h - tail.load(std::memory_order_acquire) == STEP_RING_BATCHES) {
+            if (cancelled.load(std::memory_order_relaxed)) throw SRecordingCancelled{};
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (cancelled.load(std::memory_order_relaxed)) throw SRecordingCancelled{};
+
+        SStepBatch &slot = slots[h % STEP_RING_BATCHES];
+        std::copy(steps, steps + count, slot.steps);
+        slot.count = count;
+        produced.fetch_add(count, std::memory_order_relaxed);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    void close() { closed.store(true, std::memory_order_release); }
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+    //consumer side
+    [[nodiscard]] const SStepBatch* front() const {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return nullptr;
+        return &slots[t % STEP_RING_BATCHES];
+    }
+
+    void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    [[nodiscard]] bool isClosed() const { return closed.load(std::memory_order_acquire); }
+    [[nodiscard]] long long producedSteps() const { return produced.load(std::memory_order_relaxed); }
+};
+
+//runs a recording function on a producer thread and hands its steps out one by one;
+//memory stays at one ring plus one batch however long the trace gets. The producer
+//allocates from an arena that is reset for every recording, so sorting again maps
+//no new memory unless the input grew
+class CAsyncRecording {
+private:
+    std::unique_ptr<CStepRing> ring;
+    std::thread producer;
+    CArena arena;
+    int batchPos = 0;
+
+public:
+    CAsyncRecording() = default;
+    ~CAsyncRecording() { stop(); }
+
+    CAsyncRecording(const CAsyncRecording&) = delete;
+    CAsyncRecording& operator=(const CAsyncRecording&) = delete;
+
+    //record(SStepBuffer&, CArena&) runs on the producer thread
+    template<typename F>
+    void start(F record) {
+        stop();
+        arena.reset();
+        ring = std::make_unique<CStepRing>();
+        batchPos = 0;
+        CStepRing* r = ring.get();
+        CArena* a = &arena;
+        producer = std::thread([r, a, record = std::move(record)]() mutable {
+            CProfiler::nameThread("recording");
+            SStepBuffer buffer;
+            buffer.arena = a;
+            buffer.reserve(STEP_BATCH_SIZE);
+            buffer.sink = r;
+            try {
+                record(buffer, *a);
+                buffer.flushSink();
+            } catch (const SRecordingCancelled&) {
+                //the UI went back to the menu, drop the rest of the trace
+            }
+            r->close();
+        });
+    }
+
+    //cancels a running producer and waits for it
+    void stop() {
+        if (ring) ring->cancel();
+        if (producer.joinable()) producer.join();
+        ring.reset();
+        batchPos = 0;
+    }
+
+    //next recorded step, false when none is available yet
+    bool next(SStep &out) {
+        if (!ring) return false;
+        const SStepBatch* batch = ring->front();
+        if (!batch) return false;
+        out = batch->steps[batchPos++];
+        if (batchPos == batch->count) {
+            ring->pop();
+            batchPos = 0;
+        }
+        return true;
+    }
+
+    //true once the producer is done and every step was handed out
+    [[nodiscard]] bool exhausted() const {
+        return !ring || (ring->isClosed() && ring->front() == nullptr);
+    }
+
+    [[nodiscard]] bool complete() const { return !ring || ring->isClosed(); }
+    [[nodiscard]] long long producedSteps() const { return ring ? ring->producedSteps() : 0; }
+    [[nodiscard]] std::size_t bytes() const {
+        return ring ? sizeof(CStepRing) + STEP_BLOCK_SIZE * sizeof(SStep) : 0;
+    }
+};
+
+// -----------------------------
+// Input generators
+// -----------------------------
+enum DistKind {
+    DIST_UNIFORM = 0,
+    DIST_SORTED,
+    DIST_REVERSED,
+    DIST_FEW_UNIQUE,
+    DIST_SAWTOOTH,
+    DIST_ORGAN_PIPE,
+    DIST_ZIPF,
+    DIST_GAUSSIAN,
+    DIST_NEARLY_SORTED,
+    DIST_COUNT
+};
+
+const char* const DIST_NAMES[DIST_COUNT] = {
+    "uniform", "sorted", "reversed", "few-unique", "sawtooth",
+    "organ-pipe", "zipf", "gaussian", "nearly-sorted"
+};
+
+//the generator of the practice driver, with the same 64-bit arithmetic, so a
+//(distribution, seed) pair shown here can be reproduced there for any range; every
+//chunk has its own seed, so filling them on one thread gives the same values
+constexpr std::size_t GEN_CHUNK = std::size_t(1) << 16;
+constexpr int GEN_FEW_UNIQUE_VALUES = 8;
+constexpr int GEN_SAWTOOTH_TEETH = 5;
+constexpr std::size_t GEN_ZIPF_MAX_RANKS = std::size_t(1) << 16;
+
+//xoshiro256** seeded through splitmix64
+struct SXoshiro256 {
+    std::uint64_t s[4];
+
+    explicit SXoshiro256(std::uint64_t seed) {
+        for (auto &w : s) w = splitMix64(seed);
+    }
+
+    static std::uint64_t splitMix64(std::uint64_t &x) {
+        std::uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::uint64_t next() {
+        const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    //value in [0, bound), bound must fit in 32 bits (Lemire's multiply-shift)
+    std::uint64_t below(std::uint64_t bound) { return ((next() >> 32) * bound) >> 32; }
+
+    //value in [0, 1)
+    double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+};
+
+class CInputGenerator {
+public:
+    CInputGenerator(DistKind kind, std::uint64_t seed, int lo, int hi, int swapPercent = 5)
+        : kind(kind), seed(seed), lo(lo), hi(hi), swapPercent(swapPercent) {
+        if (kind == DIST_ZIPF) buildZipfTable();
+    }
+
+    void fill(int out[], std::size_t n) const {
+        if (n == 0) return;
+        const std::size_t chunks = (n + GEN_CHUNK - 1) / GEN_CHUNK;
+        for (std::size_t c = 0; c < chunks; ++c) {
+            fillChunk(out, n, c * GEN_CHUNK, std::min(n, (c + 1) * GEN_CHUNK), c);
+        }
+
+        if (kind == DIST_NEARLY_SORTED && n > 1) {
+            SXoshiro256 rng(seed ^ 0xD1B54A32D192ED03ULL);
+            const std::size_t swaps = n * static_cast<std::size_t>(swapPercent) / 100;
+            for (std::size_t k = 0; k < swaps; ++k) {
+                std::swap(out[rng.below(n)], out[rng.below(n)]);
+            }
+        }
+    }
+
+private:
+    DistKind kind;
+    std::uint64_t seed;
+    int lo;
+    int hi;
+    int swapPercent;
+    std::vector<double> zipfCdf;
+
+    [[nodiscard]] std::uint64_t range() const {
+        return static_cast<std::uint64_t>(std::int64_t(hi) - lo) + 1;
+    }
+
+    //value at position k of an ascending ramp from lo to hi over n elements
+    [[nodiscard]] int ramp(std::size_t k, std::size_t n) const {
+        if (n <= 1) return lo;
+        double t = static_cast<double>(k) / static_cast<double>(n - 1);
+        return static_cast<int>(lo + static_cast<std::int64_t>(t * static_cast<double>(range() - 1)));
+    }
+
+    void buildZipfTable() {
+        const std::size_t ranks = std::min<std::uint64_t>(range(), GEN_ZIPF_MAX_RANKS);
+        zipfCdf.resize(ranks);
+        double sum = 0.0;
+        for (std::size_t r = 0; r < ranks; ++r) {
+            sum += 1.0 / static_cast<double>(r + 1);
+            zipfCdf[r] = sum;
+        }
+        for (auto &c : zipfCdf) c /= sum;
+    }
+
+    void fillChunk(int out[], std::size_t n, std::size_t begin, std::size_t end, std::size_t chunk) const {
+        SXoshiro256 rng(seed + chunk * 0x9E3779B97F4A7C15ULL);
+        const std::uint64_t r = range();
+
+        for (std::size_t k = begin; k < end; ++k) {
+            int v;
+            switch (kind) {
+                case DIST_SORTED:
+                case DIST_NEARLY_SORTED:
+                    v = ramp(k, n);
+                    break;
+                case DIST_REVERSED:
+                    v = ramp(n - 1 - k, n);
+                    break;
+                case DIST_FEW_UNIQUE: {
+                    auto bucket = static_cast<double>(rng.below(GEN_FEW_UNIQUE_VALUES));
+                    v = static_cast<int>(lo + static_cast<std::int64_t>(bucket * static_cast<double>(r - 1) / (GEN_FEW_UNIQUE_VALUES - 1)));
+                    break;
+                }
+                case DIST_SAWTOOTH: {
+                    std::size_t period = std::max<std::size_t>(2, (n + GEN_SAWTOOTH_TEETH - 1) / GEN_SAWTOOTH_TEETH);
+                    v = ramp(k % period, period);
+                    break;
+                }
+                case DIST_ORGAN_PIPE: {
+                    std::size_t half = (n + 1) / 2;
+                    v = k < half ? ramp(k, half) : ramp(n - 1 - k, half);
+                    break;
+                }
+                case DIST_ZIPF: {
+                    double u = rng.unit();
+                    std::size_t rank = std::lower_bound(zipfCdf.begin(), zipfCdf.end(), u) - zipfCdf.begin();
+                    rank = std::min(rank, zipfCdf.size() - 1);
+                    v = static_cast<int>(lo + static_cast<std::int64_t>(rank * r / zipfCdf.size()));
+                    break;
+                }
+                case DIST_GAUSSIAN: {
+                    //Box-Muller, mean in the middle of the range, 3 sigma to the edges
+                    double u1 = 1.0 - rng.unit();
+                    double u2 = rng.unit();
+                    double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * std::numbers::pi * u2);
+                    double mid = (static_cast<double>(lo) + hi) / 2.0;
+                    double x = mid + z * static_cast<double>(r) / 6.0;
+                    x = std::min<double>(std::max<double>(x, lo), hi);
+                    v = static_cast<int>(x);
+                    break;
+                }
+                case DIST_UNIFORM:
+                default:
+                    v = static_cast<int>(lo + static_cast<std::int64_t>(rng.below(r)));
+                    break;
+            }
+            out[k] = v;
+        }
+    }
 };
 
 // -----------------------------
@@ -69,34 +745,40 @@ struct SStepBuffer {
 // -----------------------------
 class CSorter {
 protected:
-    int data[CONST_MAX_LENGTH]{};  //initializing array with 0
+    //the copy of the input and any scratch space live in the arena of the recording
+    CArena &arena;
+    ArenaVector<int> data;
     int size;
 
 public:
-    CSorter(const int input[], int n) : size(n) {
-        for (int i = 0; i < n; ++i) data[i] = input[i];
-    }
+    CSorter(const int input[], int n, CArena &arena)
+        : arena(arena), data(input, input + n, CArenaAllocator<int>(arena)), size(n) {}
 
     virtual ~CSorter() = default;
 
-    //selection sort with optional recording
-    void selectionSort(SStepBuffer* rec = nullptr) {
+    void selectionSort() {
+        SNullRecorder none;
+        selectionSort(none);
+    }
+
+    template<StepRecorder R>
+    void selectionSort(R &rec) {
         for (int j = 0; j < size - 1; ++j) {
             int minVal = INT_MAX;
             int posMin = -1;
             for (int i = j; i < size; ++i) {
                 int elem = data[i];
-                if (rec) rec->push_back(SStep{ACT_COMPARE, posMin, i, 0});
+                rec.push_back(SStep{ACT_COMPARE, posMin, i, 0});
                 if (elem < minVal) {
                     minVal = elem;
                     posMin = i;
                 }
             }
             if (posMin != j) {
-                if (rec) rec->push_back(SStep{ACT_SWAP, j, posMin, 0});
+                rec.push_back(SStep{ACT_SWAP, j, posMin, 0});
                 std::swap(data[j], data[posMin]);
             }
-            if (rec) rec->push_back(SStep{ACT_HIGHLIGHT, j, -1, 0});
+            rec.push_back(SStep{ACT_HIGHLIGHT, j, -1, 0});
         }
     }
 
@@ -104,101 +786,287 @@ public:
     virtual void mergeSort() {}
     virtual void quickSort() {}
 
-    void insertionSort(SStepBuffer* rec = nullptr) {
+    void insertionSort() {
+        SNullRecorder none;
+        insertionSort(none);
+    }
+
+    template<StepRecorder R>
+    void insertionSort(R &rec) {
         for (int i = 0; i <= size - 1; ++i) {
             int j = i;
             while (j > 0 && data[j-1] > data[j]) {
-                if (rec) {
-                    rec->push_back(SStep{ACT_COMPARE,j-1,j,0});
-                    rec->push_back(SStep{ACT_SWAP,j,j-1,0});
-                }
+                rec.push_back(SStep{ACT_COMPARE,j-1,j,0});
+                rec.push_back(SStep{ACT_SWAP,j,j-1,0});
                 std::swap(data[j], data[j-1]);
                 --j;
             }
-            if (rec) rec->push_back(SStep{ACT_HIGHLIGHT, i, -1, 0});
+            rec.push_back(SStep{ACT_HIGHLIGHT, i, -1, 0});
         }
     }
 };
 
 class CHeapSorter : public CSorter {
 public:
-    CHeapSorter(const int input[], int n): CSorter(input, n) {}
+    CHeapSorter(const int input[], int n, CArena &arena): CSorter(input, n, arena) {}
 
 
-    void heapSort(SStepBuffer* rec = nullptr) {
+    void heapSort() override {
+        SNullRecorder none;
+        heapSort(none);
+    }
+
+    template<StepRecorder R>
+    void heapSort(R &rec) {
+        CZone zone("heapSort");
         for (int i = size/2 - 1; i >= 0; --i) {
             heapify(size, i, rec);
         }
         for (int i = size - 1; i > 0; --i) {
 
-            if (rec) rec ->push_back(SStep{ACT_SWAP,0,i,0});
+            rec.push_back(SStep{ACT_SWAP,0,i,0});
             std::swap(data[0], data[i]);
 
-            if (rec) rec -> push_back(SStep{ACT_HIGHLIGHT,i,-1,0});
+            rec.push_back(SStep{ACT_HIGHLIGHT,i,-1,0});
             heapify(i, 0, rec);
         }
 
-        if (rec && size > 0) rec->push_back(SStep{ACT_HIGHLIGHT,0,-1,0});
+        if (size > 0) rec.push_back(SStep{ACT_HIGHLIGHT,0,-1,0});
     }
 private:
-    void heapify(int n, int i, SStepBuffer* rec) {
+    template<StepRecorder R>
+    void heapify(int n, int i, R &rec) {
+        CZone zone("heapify");
         int largest = i;
         int left = 2*i + 1;
         int right = 2*i + 2;
 
         if (left < n) {
-            if (rec) rec->push_back(SStep{ACT_COMPARE, largest, left, 0});
+            rec.push_back(SStep{ACT_COMPARE, largest, left, 0});
             if (data[left] > data[largest]) largest = left;
         }
 
         if (right < n) {
-            if (rec) rec->push_back(SStep{ACT_COMPARE, largest, right, 0});
+            rec.push_back(SStep{ACT_COMPARE, largest, right, 0});
             if (data[right] > data[largest]) largest = right;
         }
 
         if (largest != i) {
-            if (rec) rec->push_back(SStep{ACT_SWAP, i, largest, 0});
+            rec.push_back(SStep{ACT_SWAP, i, largest, 0});
             std::swap(data[i], data[largest]);
 
             heapify(n, largest, rec);
         } else {
-            if (rec) rec->push_back(SStep{ACT_HIGHLIGHT, i, -1, 0});
+            rec.push_back(SStep{ACT_HIGHLIGHT, i, -1, 0});
         }
 
     }
 };
 
+//the in-place merge sort of the practice driver with a much smaller run and buffer,
+//so that the rotations already show up on the menu sizes
+constexpr int INPLACE_MERGE_RUN = 4;
+constexpr int INPLACE_MERGE_BUFFER = 4;
+
 class CMergeSorter : public CSorter {
 public:
-    CMergeSorter(const int input[], int n): CSorter(input, n) {}
+    CMergeSorter(const int input[], int n, CArena &arena): CSorter(input, n, arena) {}
+
+
+    void mergeSort() override {
+        SNullRecorder none;
+        mergeSort(none);
+    }
+
+    template<StepRecorder R>
+    void mergeSort(R &rec) {
+        //the copies of both halves on every level down one path fit in 2 * size, plus
+        //one element per level where the right half rounds up
+        int* scratch = arena.allocate<int>(2 * static_cast<std::size_t>(size) + 32);
+        mergeSortHelper(data.data(), size, rec, 0, scratch);
+    }
+
+    void mergeSortInPlace() {
+        SNullRecorder none;
+        mergeSortInPlace(none);
+    }
+
+    //stable and in place: insertion sorted runs, then bottom-up merges through a buffer
+    //of INPLACE_MERGE_BUFFER elements or, when both sides are longer, SymMerge rotations
+    //(recorded as swaps); every finished merge is highlighted like in mergeSort
+    template<StepRecorder R>
+    void mergeSortInPlace(R &rec) {
+        for (int start = 0; start < size; start += INPLACE_MERGE_RUN) {
+            const int end = std::min(start + INPLACE_MERGE_RUN, size);
+            for (int i = start + 1; i < end; ++i) {
+                for (int j = i; j > start; --j) {
+                    rec.push_back(SStep{ACT_COMPARE, j - 1, j, 0});
+                    if (data[j - 1] <= data[j]) break;
+                    rec.push_back(SStep{ACT_SWAP, j - 1, j, 0});
+                    std::swap(data[j - 1], data[j]);
+                }
+            }
+        }
+        for (int width = INPLACE_MERGE_RUN; width < size; width *= 2) {
+            for (int first = 0; first + width < size; first += 2 * width) {
+                const int last = std::min(first + 2 * width, size);
+                mergeInPlace(first, first + width, last, rec);
+                for (int k = first; k < last; ++k) rec.push_back(SStep{ACT_HIGHLIGHT, k, -1, 0});
+            }
+        }
+    }
 
+    //re-sorts an array that was in order before the entries at the ascending, distinct
+    //indices in changed were overwritten, like resortChanged in the practice driver:
+    //the unchanged entries slide down over the gaps, the changed ones are copied behind
+    //them, merge sorted there and merged in from the back
+    template<StepRecorder R>
+    void resortChanged(const std::vector<int> &changed, R &rec) {
+        const int count = static_cast<int>(changed.size());
+        int* scratch = arena.allocate<int>(2 * static_cast<std::size_t>(count) + 32);
+
+        int out = count > 0 ? changed[0] : size;
+        for (int c = 0; c < count; ++c) {
+            scratch[c] = data[changed[c]];
+            rec.push_back(SStep{ACT_COMPARE, changed[c], -1, 0});
+            const int next = c + 1 < count ? changed[c + 1] : size;
+            for (int k = changed[c] + 1; k < next; ++k, ++out) {
+                data[out] = data[k];
+                rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+            }
+        }
+        for (int c = 0; c < count; ++c, ++out) {
+            data[out] = scratch[c];
+            rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+        }
 
-    void mergeSort(SStepBuffer* rec = nullptr) {
-        mergeSortHelper(data, size, rec, 0);
+        const int sorted = size - count;
+        mergeSortHelper(data.data() + sorted, count, rec, sorted, scratch);
+        if (sorted > 0 && count > 0) {
+            rec.push_back(SStep{ACT_COMPARE, sorted - 1, sorted, 0});
+            if (data[sorted - 1] > data[sorted]) {
+                //the tail is shown at the index it was copied from
+                std::copy(data.begin() + sorted, data.end(), scratch);
+                int l = sorted, r = count;
+                out = size;
+                while (l > 0 && r > 0) {
+                    rec.push_back(SStep{ACT_COMPARE, l - 1, sorted + r - 1, 0});
+                    --out;
+                    data[out] = scratch[r - 1] < data[l - 1] ? data[--l] : scratch[--r];
+                    rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+                }
+                while (r > 0) {
+                    --out;
+                    data[out] = scratch[--r];
+                    rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+                }
+            }
+        }
+        for (int k = 0; k < size; ++k) rec.push_back(SStep{ACT_HIGHLIGHT, k, -1, 0});
     }
+
 private:
-    void static mergeSortHelper(int array[], int length, SStepBuffer* rec, int start) {
+    int buffer[INPLACE_MERGE_BUFFER] = {};
+
+    //stable merge of [first, middle) and [middle, last); buffered elements are shown at
+    //the index they were copied from
+    template<StepRecorder R>
+    void mergeInPlace(int first, int middle, int last, R &rec) {
+        if (first == middle || middle == last) return;
+        rec.push_back(SStep{ACT_COMPARE, middle - 1, middle, 0});
+        if (data[middle - 1] <= data[middle]) return;
+
+        if (middle - first <= INPLACE_MERGE_BUFFER) {
+            std::copy(data.begin() + first, data.begin() + middle, buffer);
+            int l = 0, r = middle, out = first;
+            const int leftSize = middle - first;
+            while (l < leftSize && r < last) {
+                rec.push_back(SStep{ACT_COMPARE, first + l, r, 0});
+                data[out] = data[r] < buffer[l] ? data[r++] : buffer[l++];
+                rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+                ++out;
+            }
+            while (l < leftSize) {
+                data[out] = buffer[l++];
+                rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+                ++out;
+            }
+            return;
+        }
+        if (last - middle <= INPLACE_MERGE_BUFFER) {
+            std::copy(data.begin() + middle, data.begin() + last, buffer);
+            int l = middle, r = last - middle, out = last;
+            while (l > first && r > 0) {
+                rec.push_back(SStep{ACT_COMPARE, l - 1, middle + r - 1, 0});
+                --out;
+                data[out] = buffer[r - 1] < data[l - 1] ? data[--l] : buffer[--r];
+                rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+            }
+            while (r > 0) {
+                --out;
+                data[out] = buffer[--r];
+                rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+            }
+            return;
+        }
+
+        const int mid = first + (last - first) / 2;
+        const int n = mid + middle;
+        int start = middle > mid ? n - last : first;
+        int r = middle > mid ? mid : middle;
+        while (start < r) {
+            int c = start + (r - start) / 2;
+            rec.push_back(SStep{ACT_COMPARE, n - 1 - c, c, 0});
+            if (!(data[n - 1 - c] < data[c])) {
+                start = c + 1;
+            } else {
+                r = c;
+            }
+        }
+        const int end = n - start;
+        if (start < middle && middle < end) {
+            //rotation by three reversals
+            reverse(start, middle, rec);
+            reverse(middle, end, rec);
+            reverse(start, end, rec);
+        }
+        if (first < start && start < mid) mergeInPlace(first, start, mid, rec);
+        if (mid < end && end < last) mergeInPlace(mid, end, last, rec);
+    }
+
+    template<StepRecorder R>
+    void reverse(int first, int last, R &rec) {
+        for (--last; first < last; ++first, --last) {
+            rec.push_back(SStep{ACT_SWAP, first, last, 0});
+            std::swap(data[first], data[last]);
+        }
+    }
+
+    //the halves are copied to the front of scratch, the recursion uses the rest
+    template<StepRecorder R>
+    void static mergeSortHelper(int array[], int length, R &rec, int start, int scratch[]) {
         if (length <= 1) return;
+        CZone zone("mergeSortHelper");
 
         int middle = length / 2;
-        int leftArray[CONST_MAX_LENGTH];
-        int rightArray[CONST_MAX_LENGTH];
         int leftSize = middle, rightSize = length - middle;
-
-        for (int i = 0; i < leftSize; ++i) {
-            leftArray[i]  = array[i];
-        }
-        for (int i = 0; i < rightSize; ++i) {
-            rightArray[i] = array[middle + i];
+        int* leftArray = scratch;
+        int* rightArray = scratch + leftSize;
+        {
+            CZone copyZone("merge copy");
+            std::copy(array, array + leftSize, leftArray);
+            std::copy(array + middle, array + length, rightArray);
         }
 
-        mergeSortHelper(leftArray, leftSize, rec,start);
-        mergeSortHelper(rightArray, rightSize, rec, start + middle);
+        mergeSortHelper(leftArray, leftSize, rec, start, scratch + length);
+        mergeSortHelper(rightArray, rightSize, rec, start + middle, scratch + length);
         merge(leftArray, leftSize, rightArray, rightSize, array, start, middle, rec);
     }
 
+    template<StepRecorder R>
     static void merge(const int leftArray[], int leftSize, const int rightArray[],
-        int rightSize, int array[], int start, int middle, SStepBuffer* rec) {
+        int rightSize, int array[], int start, int middle, R &rec) {
+        CZone zone("merge");
 
         int i = 0, l = 0, r = 0;
 
@@ -207,18 +1075,18 @@ private:
             int rightGlobalIdx = start +  middle + r;
             int writeGlobalIdx = start + i;
 
-            if (rec) rec->push_back(SStep{ACT_COMPARE,leftGlobalIdx,rightGlobalIdx,0});
+            rec.push_back(SStep{ACT_COMPARE,leftGlobalIdx,rightGlobalIdx,0});
 
 
 
             if (leftArray[l] <= rightArray[r]) {
                 array[i] = leftArray[l];
-                if (rec) rec->push_back(SStep{ACT_OVERWRITE,writeGlobalIdx, -1, leftArray[l]});
+                rec.push_back(SStep{ACT_OVERWRITE,writeGlobalIdx, -1, leftArray[l]});
                 ++l;
             }
             else {
                 array[i] = rightArray[r];
-                if (rec) rec->push_back(SStep{ACT_OVERWRITE,writeGlobalIdx, -1, rightArray[r]});
+                rec.push_back(SStep{ACT_OVERWRITE,writeGlobalIdx, -1, rightArray[r]});
                 ++r;
             }
             ++i;
@@ -226,64 +1094,731 @@ private:
         while (l < leftSize) {
             int writeGlobalIdx = start + i;
             array[i] = leftArray[l];
-            if (rec) rec->push_back(SStep{ACT_OVERWRITE, writeGlobalIdx, -1, leftArray[l]});
+            rec.push_back(SStep{ACT_OVERWRITE, writeGlobalIdx, -1, leftArray[l]});
             ++l; ++i;
         }
         while (r < rightSize) {
             int writeGlobalIdx = start + i;
             array[i] = rightArray[r];
-            if (rec) rec->push_back(SStep{ACT_OVERWRITE, writeGlobalIdx, -1, rightArray[r]});
+            rec.push_back(SStep{ACT_OVERWRITE, writeGlobalIdx, -1, rightArray[r]});
             ++r; ++i;
         }
 
-        if (rec) {
-            for (int k = 0; k < i; ++k) {
-                int idx = start + k;
-                rec->push_back(SStep{ACT_HIGHLIGHT, idx, -1, 0});
-            }
-        }
+        for (int k = 0; k < i; ++k) {
+            int idx = start + k;
+            rec.push_back(SStep{ACT_HIGHLIGHT, idx, -1, 0});
+        }
+    }
+};
+
+//PART_THREE_WAY keeps keys equal to the pivot out of the recursion (Bentley-McIlroy)
+enum PartitionMode {
+    PART_LOMUTO = 0,
+    PART_THREE_WAY = 1
+};
+
+class CQuickSorter : public CSorter {
+public:
+    CQuickSorter(int input[], int n, CArena &arena, PartitionMode mode = PART_LOMUTO): CSorter(input, n, arena), mode(mode) {}
+
+    void quickSort() override {
+        SNullRecorder none;
+        quickSort(none);
+    }
+
+    template<StepRecorder R>
+    void quickSort(R &rec) {
+        if (mode == PART_THREE_WAY) {
+            quickSortThreeWay(data.data(), 0, size - 1, rec);
+        } else {
+            quickSortRecursive(data.data(), 0, size - 1, rec);
+        }
+    }
+private:
+    PartitionMode mode;
+
+    //after partitioning: [start..j] < pivot, (j..i) == pivot, [i..end] > pivot
+    template<StepRecorder R>
+    void static quickSortThreeWay(int array[], int start, int end, R &rec) {
+        if (start >= end) return;
+        CZone zone("quickSortThreeWay");
+        CZone partitionZone("partitionThreeWay");
+
+        int pivot = array[end];
+        //keys equal to the pivot are parked in [start..p] and [q..end-1] while scanning
+        int i = start - 1, j = end;
+        int p = start - 1, q = end;
+
+        while (true) {
+            while (true) {
+                ++i;
+                rec.push_back(SStep{ACT_COMPARE, i, end, 0});
+                if (!(array[i] < pivot)) break;
+            }
+            while (true) {
+                --j;
+                rec.push_back(SStep{ACT_COMPARE, j, end, 0});
+                if (!(pivot < array[j]) || j == start) break;
+            }
+            if (i >= j) break;
+
+            rec.push_back(SStep{ACT_SWAP, i, j, 0});
+            std::swap(array[i], array[j]);
+
+            if (array[i] == pivot && ++p != i) {
+                rec.push_back(SStep{ACT_SWAP, p, i, 0});
+                std::swap(array[p], array[i]);
+            }
+            if (array[j] == pivot && --q != j) {
+                rec.push_back(SStep{ACT_SWAP, q, j, 0});
+                std::swap(array[q], array[j]);
+            }
+        }
+        if (i != end) {
+            rec.push_back(SStep{ACT_SWAP, i, end, 0});
+            std::swap(array[i], array[end]);
+        }
+
+        //move the parked equal keys next to the pivot
+        j = i - 1;
+        i = i + 1;
+        for (int k = start; k <= p; ++k, --j) {
+            if (k != j) {
+                rec.push_back(SStep{ACT_SWAP, k, j, 0});
+                std::swap(array[k], array[j]);
+            }
+        }
+        for (int k = end - 1; k >= q; --k, ++i) {
+            if (k != i) {
+                rec.push_back(SStep{ACT_SWAP, k, i, 0});
+                std::swap(array[k], array[i]);
+            }
+        }
+
+        //the whole run of pivot-equal keys is final
+        for (int k = j + 1; k < i; ++k) rec.push_back(SStep{ACT_HIGHLIGHT, k, -1, 0});
+        partitionZone.end();
+
+        quickSortThreeWay(array, start, j, rec);
+        quickSortThreeWay(array, i, end, rec);
+    }
+    template<StepRecorder R>
+    void static quickSortRecursive(int array[], int start, int end, R &rec) {
+        if (start >= end) return;
+        CZone zone("quickSortRecursive");
+        CZone partitionZone("partition");
+
+        int pivot = array[end];
+
+        int i = start - 1;
+        for (int j = start; j < end; ++j) {
+
+            rec.push_back(SStep{ACT_COMPARE, j,end, 0});
+
+            if (array[j] < pivot) {
+                ++i;
+                if (i != j) {
+                    rec.push_back(SStep{ACT_SWAP,i,j,0});
+                }
+                std::swap(array[j], array[i]);
+            }
+        }
+
+        if (i+1 != end) {
+            rec.push_back(SStep{ACT_SWAP, i+1, end, 0});
+            std::swap(array[i+1],array[end]);
+        }
+
+        rec.push_back(SStep{ACT_HIGHLIGHT, i+1,-1,0});
+        partitionZone.end();
+
+
+        quickSortRecursive(array, start, i, rec);
+        quickSortRecursive(array, i+2, end, rec);
+    }
+};
+
+//histogram based sort for small key ranges; the counting pass shows up as reads,
+//the output pass as overwrites that are final right away
+class CCountingSorter : public CSorter {
+public:
+    CCountingSorter(const int input[], int n, CArena &arena): CSorter(input, n, arena) {}
+
+    void countingSort() {
+        SNullRecorder none;
+        countingSort(none);
+    }
+
+    template<StepRecorder R>
+    void countingSort(R &rec) {
+        if (size <= 1) {
+            if (size == 1) rec.push_back(SStep{ACT_HIGHLIGHT, 0, -1, 0});
+            return;
+        }
+
+        int lo = data[0], hi = data[0];
+        for (int k = 1; k < size; ++k) {
+            lo = std::min(lo, data[k]);
+            hi = std::max(hi, data[k]);
+        }
+
+        std::vector<int> counts(static_cast<std::size_t>(hi - lo) + 1, 0);
+        for (int k = 0; k < size; ++k) {
+            rec.push_back(SStep{ACT_COMPARE, k, -1, 0});
+            ++counts[data[k] - lo];
+        }
+
+        int out = 0;
+        for (std::size_t v = 0; v < counts.size(); ++v) {
+            for (int c = 0; c < counts[v]; ++c) {
+                data[out] = lo + static_cast<int>(v);
+                rec.push_back(SStep{ACT_OVERWRITE, out, -1, data[out]});
+                rec.push_back(SStep{ACT_HIGHLIGHT, out, -1, 0});
+                ++out;
+            }
+        }
+    }
+};
+
+//the bitonic and odd-even merge networks of the practice driver, one compare step per
+//comparator and a swap when the pair is out of order. The pattern depends only on n.
+//Lengths are padded to a power of two with virtual +inf keys, so every comparator
+//that reaches past the end is left out. For that, all comparators put the smaller key
+//first: bitonic merges start by comparing each half against the other half mirrored
+//instead of sorting half of the blocks descending
+class CNetworkSorter : public CSorter {
+public:
+    CNetworkSorter(const int input[], int n, CArena &arena): CSorter(input, n, arena) {}
+
+    void bitonicSort() {
+        SNullRecorder none;
+        bitonicSort(none);
+    }
+
+    template<StepRecorder R>
+    void bitonicSort(R &rec) {
+        const int padded = static_cast<int>(std::bit_ceil(static_cast<unsigned>(std::max(size, 1))));
+        for (int k = 2; k <= padded; k *= 2) {
+            for (int s = 0; s < size; s += k) {
+                for (int t = 0; t < k / 2; ++t) compareExchange(s + t, s + k - 1 - t, rec);
+            }
+            for (int j = k / 4; j > 0; j /= 2) {
+                for (int a = 0; a < size; ++a) {
+                    if ((a & j) == 0) compareExchange(a, a + j, rec);
+                }
+            }
+        }
+        for (int k = 0; k < size; ++k) rec.push_back(SStep{ACT_HIGHLIGHT, k, -1, 0});
+    }
+
+    void oddEvenMergeSort() {
+        SNullRecorder none;
+        oddEvenMergeSort(none);
+    }
+
+    template<StepRecorder R>
+    void oddEvenMergeSort(R &rec) {
+        const int padded = static_cast<int>(std::bit_ceil(static_cast<unsigned>(std::max(size, 1))));
+        for (int p = 1; p < padded; p *= 2) {
+            for (int k = p; k > 0; k /= 2) {
+                for (int j = k % p; j + k < size; j += 2 * k) {
+                    for (int a = j; a < j + k; ++a) {
+                        if (a / (2 * p) == (a + k) / (2 * p)) compareExchange(a, a + k, rec);
+                    }
+                }
+            }
+        }
+        for (int k = 0; k < size; ++k) rec.push_back(SStep{ACT_HIGHLIGHT, k, -1, 0});
+    }
+
+private:
+    template<StepRecorder R>
+    void compareExchange(int a, int b, R &rec) {
+        if (b >= size) return;
+        rec.push_back(SStep{ACT_COMPARE, a, b, 0});
+        if (data[b] < data[a]) {
+            rec.push_back(SStep{ACT_SWAP, a, b, 0});
+            std::swap(data[a], data[b]);
+        }
+    }
+};
+
+//picks an engine from a quick look at the input, with the thresholds and the sampled
+//profile of sortAuto in the practice driver; three-way quick sort stands in for its
+//introsort
+constexpr int AUTO_INSERTION_MAX = 32;
+//adjacent pairs sampled to estimate the runs and the duplicates
+constexpr int AUTO_SAMPLE_SIZE = 1024;
+constexpr double AUTO_PRESORTED_DIVISOR = 64.0;
+constexpr int AUTO_COUNTING_MAX_RANGE = 1 << 16;
+
+enum AutoEngine {
+    AUTO_INSERTION = 0,
+    AUTO_COUNTING,
+    AUTO_MERGE,
+    AUTO_QUICK_THREE_WAY
+};
+
+struct SAutoDecision {
+    AutoEngine engine;
+    const char* reason;
+    int runs;               //estimated from the sampled descents
+    std::int64_t range;
+    double duplicateRatio;  //sampled keys equal to their sorted neighbour
+};
+
+class CAutoSorter {
+public:
+    //one pass for the exact key range, the runs and duplicates come from evenly spaced
+    //samples, so the UI thread never copies or sorts the whole input
+    static SAutoDecision decide(const int values[], int n) {
+        SAutoDecision d{AUTO_QUICK_THREE_WAY, "general input", 1, 0, 0.0};
+        if (n <= 0) return d;
+
+        int lo = values[0], hi = values[0];
+        for (int k = 1; k < n; ++k) {
+            lo = std::min(lo, values[k]);
+            hi = std::max(hi, values[k]);
+        }
+        d.range = std::int64_t(hi) - lo + 1;
+
+        const int pairs = n - 1;
+        const int samples = std::min(pairs, AUTO_SAMPLE_SIZE);
+        int descents = 0;
+        std::vector<int> keys(samples);
+        for (int s = 0; s < samples; ++s) {
+            int k = static_cast<int>(std::int64_t(s) * pairs / samples);
+            if (values[k] > values[k + 1]) ++descents;
+            keys[s] = values[k];
+        }
+        if (samples > 0) {
+            d.runs = 1 + static_cast<int>(std::int64_t(descents) * pairs / samples);
+            std::sort(keys.begin(), keys.end());
+            int equal = 0;
+            for (int s = 1; s < samples; ++s) {
+                if (keys[s] == keys[s - 1]) ++equal;
+            }
+            d.duplicateRatio = static_cast<double>(equal) / samples;
+        }
+
+        if (n <= AUTO_INSERTION_MAX) {
+            d.engine = AUTO_INSERTION;
+            d.reason = "tiny input";
+        } else if (descents == 0 && samples == pairs) {
+            d.engine = AUTO_INSERTION;
+            d.reason = "already in order";
+        } else if (d.range <= AUTO_COUNTING_MAX_RANGE && d.range <= 2 * std::int64_t(n)) {
+            d.engine = AUTO_COUNTING;
+            d.reason = "small key range";
+        } else if (d.runs <= n / AUTO_PRESORTED_DIVISOR) {
+            d.engine = AUTO_MERGE;
+            d.reason = "few runs";
+        }
+        return d;
+    }
+};
+
+//command line names of the recorded menu entries, in menu order
+constexpr int NUM_RECORDED_METHODS = 10;
+constexpr const char* RECORDED_METHOD_NAMES[NUM_RECORDED_METHODS] = {
+    "insertion", "selection", "quick", "merge", "heap", "quick3", "counting", "merge-inplace",
+    "bitonic", "odd-even-merge"
+};
+
+//width of the method column of the --steps and --cache tables, the longest name and a space
+constexpr int METHOD_COLUMN_WIDTH = [] {
+    std::size_t longest = 0;
+    for (auto name : RECORDED_METHOD_NAMES) longest = std::max(longest, std::char_traits<char>::length(name));
+    return static_cast<int>(longest) + 1;
+}();
+
+//records the trace of one menu entry (not Auto or Race) for the given input; method
+//is the position in the menu and in RECORDED_METHOD_NAMES. The sorter's copy of the
+//input and its scratch space are taken from arena, the caller resets it
+template<StepRecorder R>
+void recordSteps(int method, int values[], int n, R &rec, CArena &arena) {
+    CZone zone("recordSteps");
+    CSorter s(values, n, arena);
+
+    switch (method) {
+        case 0: {
+            // Insertion Sort
+            s.insertionSort(rec);
+            break;
+        }
+        case 1: {
+            // Selection Sort
+            s.selectionSort(rec);
+            break;
+        }
+        case 2: {
+            // Quick Sort
+            CQuickSorter qs(values, n, arena);
+            qs.quickSort(rec);
+            break;
+        }
+        case 3: {
+            // Merge Sort
+            CMergeSorter ms(values, n, arena);
+            ms.mergeSort(rec);
+            break;
+        }
+        case 4: {
+            // Heap Sort
+            CHeapSorter hs(values, n, arena);
+            hs.heapSort(rec);
+            break;
+        }
+        case 5: {
+            // Quick Sort with three-way partitioning
+            CQuickSorter qs(values, n, arena, PART_THREE_WAY);
+            qs.quickSort(rec);
+            break;
+        }
+        case 6: {
+            // Counting Sort
+            CCountingSorter cs(values, n, arena);
+            cs.countingSort(rec);
+            break;
+        }
+        case 7: {
+            // In-place merge sort
+            CMergeSorter ms(values, n, arena);
+            ms.mergeSortInPlace(rec);
+            break;
+        }
+        case 8: {
+            // Bitonic sort
+            CNetworkSorter ns(values, n, arena);
+            ns.bitonicSort(rec);
+            break;
+        }
+        case 9: {
+            // Odd-even merge sort
+            CNetworkSorter ns(values, n, arena);
+            ns.oddEvenMergeSort(rec);
+            break;
+        }
+        default: {
+            s.selectionSort(rec);
+            break;
+        }
+    }
+}
+
+//one entry in this many (at least one) is changed for the Incremental menu entry
+constexpr int RESORT_CHANGED_DIVISOR = 20;
+
+//turns values into the input of an incremental re-sort: sorts them, then overwrites
+//entries at seeded random indices with new values in [lo, hi]. Returns the changed
+//indices in ascending order, without repeats
+std::vector<int> makeResortInput(std::vector<int> &values, std::uint64_t seed, int lo, int hi) {
+    std::sort(values.begin(), values.end());
+    const int n = static_cast<int>(values.size());
+    if (n == 0) return {};
+    SXoshiro256 rng(seed);
+    std::vector<int> changed(static_cast<std::size_t>(std::max(1, n / RESORT_CHANGED_DIVISOR)));
+    for (auto &index : changed) {
+        index = static_cast<int>(rng.below(static_cast<std::uint64_t>(n)));
+        values[index] = lo + static_cast<int>(rng.below(static_cast<std::uint64_t>(hi - lo + 1)));
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+// -----------------------------
+// Cache simulation
+// -----------------------------
+//replays the array accesses of a trace through a set-associative LRU cache hierarchy.
+//Compares and swaps touch elements i and j, overwrites touch i, highlights touch
+//nothing. Element k sits at byte k * elementBytes of the array; the scratch space of
+//merge and counting sort is not in the trace, so it is not simulated either
+constexpr std::size_t CACHE_LINE_BYTES = 64;
+constexpr int CACHE_MAX_LEVELS = 4;
+//reuse distances in cache lines, bucketed as 0, 1, 2-3, 4-7, ...
+constexpr int REUSE_BUCKETS = 40;
+constexpr int HEATMAP_ROWS = 16;
+constexpr int HEATMAP_COLUMNS = 64;
+//shorter chunks are not worth a thread
+constexpr int CACHE_MIN_CHUNK_STEPS = 1 << 20;
+//--cache refuses, and "all" leaves out, the quadratic methods above this size: their
+//traces grow with n^2 and would outgrow the int step count of SStepBuffer
+constexpr int CACHE_QUADRATIC_MAX_N = 1 << 13;
+
+//insertion and selection sort, and both quick sorts on adversarial input, record
+//about n^2 steps; the same set as isQuadratic in the practice driver
+bool isQuadraticMethod(int method) {
+    return method == 0 || method == 1 || method == 2 || method == 5;
+}
+
+struct SCacheLevelConfig {
+    std::string name;
+    std::size_t bytes;
+    int ways;
+};
+
+//a typical desktop core: 32 KiB 8-way L1, 1 MiB 16-way L2, 8 MiB 16-way LLC
+inline const std::vector<SCacheLevelConfig> DEFAULT_CACHE_LEVELS = {
+    {"L1", std::size_t(32) << 10, 8},
+    {"L2", std::size_t(1) << 20, 16},
+    {"LLC", std::size_t(8) << 20, 16}
+};
+
+struct SCacheReport {
+    long long steps = 0;
+    long long accesses = 0;
+    //misses[l] accesses reach level l + 1 (or memory for the last level)
+    long long misses[CACHE_MAX_LEVELS] = {};
+    long long reuse[REUSE_BUCKETS] = {};
+    //first touch of a line
+    long long cold = 0;
+    //accesses by time (rows) and index (columns)
+    long long heat[HEATMAP_ROWS][HEATMAP_COLUMNS] = {};
+
+    void add(const SCacheReport &other) {
+        steps += other.steps;
+        accesses += other.accesses;
+        for (int l = 0; l < CACHE_MAX_LEVELS; ++l) misses[l] += other.misses[l];
+        for (int b = 0; b < REUSE_BUCKETS; ++b) reuse[b] += other.reuse[b];
+        cold += other.cold;
+        for (int r = 0; r < HEATMAP_ROWS; ++r) {
+            for (int c = 0; c < HEATMAP_COLUMNS; ++c) heat[r][c] += other.heat[r][c];
+        }
+    }
+};
+
+class CCacheLevel {
+private:
+    int ways;
+    std::size_t sets;
+    long long clock = 0;
+    std::vector<long long> tags;
+    std::vector<long long> stamps;
+
+public:
+    CCacheLevel(std::size_t bytes, int ways)
+        : ways(std::max(ways, 1)),
+          sets(std::max<std::size_t>(1, bytes / CACHE_LINE_BYTES / static_cast<std::size_t>(std::max(ways, 1)))),
+          tags(sets * static_cast<std::size_t>(this->ways), -1),
+          stamps(sets * static_cast<std::size_t>(this->ways), 0) {}
+
+    //true on a hit; a miss replaces the least recently used way of the set
+    bool access(long long line) {
+        const std::size_t first = static_cast<std::size_t>(line) % sets * static_cast<std::size_t>(ways);
+        long long* tag = &tags[first];
+        long long* stamp = &stamps[first];
+        ++clock;
+        int victim = 0;
+        for (int w = 0; w < ways; ++w) {
+            if (tag[w] == line) {
+                stamp[w] = clock;
+                return true;
+            }
+            if (stamp[w] < stamp[victim]) victim = w;
+        }
+        tag[victim] = line;
+        stamp[victim] = clock;
+        return false;
+    }
+};
+
+//the trace is cut into chunks that are simulated on their own threads and summed. A
+//serial pass over the trace first notes when every line was last touched before each
+//chunk, and a chunk starts by touching those lines in that order. Reuse distances
+//(the number of distinct lines touched since the line was last touched, counted with
+//a Fenwick tree over access times) and cold misses are therefore the same as in one
+//serial replay, and so is the content of every cache level on its own; only the
+//order in which L1 misses reach the lower levels is approximated at chunk starts
+class CCacheSimulator {
+private:
+    std::vector<SCacheLevelConfig> levels;
+    std::size_t elementBytes;
+
+public:
+    CCacheSimulator(std::vector<SCacheLevelConfig> levels, std::size_t elementBytes)
+        : levels(std::move(levels)), elementBytes(std::max<std::size_t>(elementBytes, 1)) {
+        if (this->levels.size() > CACHE_MAX_LEVELS) this->levels.resize(CACHE_MAX_LEVELS);
+    }
+
+    //n is the array length, indices outside [0, n) are not accesses
+    [[nodiscard]] SCacheReport replay(const SStepBuffer &steps, int n) const {
+        SCacheReport report;
+        if (n <= 0) return report;
+        const int total = steps.size;
+        const int chunks = std::max(1, std::min(static_cast<int>(std::thread::hardware_concurrency()),
+                                                total / CACHE_MIN_CHUNK_STEPS));
+
+        //lastBefore[c][line] is the last access to line before chunk c, -1 for none
+        std::vector<std::vector<long long>> lastBefore(static_cast<std::size_t>(chunks));
+        std::vector<long long> last(lineCount(n), -1);
+        for (int c = 0; c < chunks; ++c) {
+            lastBefore[static_cast<std::size_t>(c)] = last;
+            for (int k = chunkStart(total, chunks, c); k < chunkStart(total, chunks, c + 1); ++k) {
+                forEachAccess(steps[k], n, [&](int index, int side) {
+                    last[lineOf(index)] = accessTime(k, side);
+                });
+            }
+        }
+
+        std::vector<std::future<SCacheReport>> parts;
+        for (int c = 1; c < chunks; ++c) {
+            parts.push_back(std::async(std::launch::async, [this, &steps, &lastBefore, n, total, chunks, c]() {
+                return replayChunk(steps, n, chunkStart(total, chunks, c), chunkStart(total, chunks, c + 1),
+                                   lastBefore[static_cast<std::size_t>(c)]);
+            }));
+        }
+        report = replayChunk(steps, n, 0, chunkStart(total, chunks, 1), lastBefore[0]);
+        for (auto &part : parts) report.add(part.get());
+        return report;
+    }
+
+private:
+    static int chunkStart(int total, int chunks, int c) {
+        return static_cast<int>(static_cast<long long>(total) * c / chunks);
+    }
+
+    //side 0 is the access to i, side 1 the access to j of the same step
+    static long long accessTime(int step, int side) {
+        return 2 * static_cast<long long>(step) + side;
     }
-};
 
-class CQuickSorter : public CSorter {
-public:
-    CQuickSorter(int input[], int n): CSorter(input, n) {}
+    [[nodiscard]] std::size_t lineCount(int n) const {
+        return static_cast<std::size_t>((static_cast<unsigned long long>(n) * elementBytes + CACHE_LINE_BYTES - 1) / CACHE_LINE_BYTES);
+    }
 
-    void quickSort(SStepBuffer* rec = nullptr) {
-        quickSortRecursive(data, 0, size - 1, rec);
+    [[nodiscard]] std::size_t lineOf(int index) const {
+        return static_cast<std::size_t>(static_cast<unsigned long long>(index) * elementBytes / CACHE_LINE_BYTES);
     }
-private:
-    void static quickSortRecursive(int array[], int start, int end, SStepBuffer* rec) {
-        if (start >= end) return;
 
-        int pivot = array[end];
+    //compares and swaps read i and j, overwrites write i, highlights touch nothing
+    template<typename F>
+    static void forEachAccess(const SStep &s, int n, F visit) {
+        const bool both = s.kind == ACT_COMPARE || s.kind == ACT_SWAP;
+        if (!both && s.kind != ACT_OVERWRITE) return;
+        if (s.i >= 0 && s.i < n) visit(s.i, 0);
+        if (both && s.j >= 0 && s.j < n) visit(s.j, 1);
+    }
 
-        int i = start - 1;
-        for (int j = start; j < end; ++j) {
+    //counts steps [first, last); lastBefore orders the lines touched before first
+    SCacheReport replayChunk(const SStepBuffer &steps, int n, int first, int last,
+                             const std::vector<long long> &lastBefore) const {
+        CZone zone("replayChunk");
+        SCacheReport report;
+        if (last <= first) return report;
 
-            if (rec) rec->push_back(SStep{ACT_COMPARE, j,end, 0});
+        std::vector<CCacheLevel> caches;
+        for (auto &level : levels) caches.emplace_back(level.bytes, level.ways);
 
-            if (array[j] < pivot) {
-                ++i;
-                if (i != j) {
-                    if (rec) rec->push_back(SStep{ACT_SWAP,i,j,0});
-                }
-                std::swap(array[j], array[i]);
-            }
+        std::vector<std::size_t> seen;
+        for (std::size_t line = 0; line < lastBefore.size(); ++line) {
+            if (lastBefore[line] >= 0) seen.push_back(line);
+        }
+        std::sort(seen.begin(), seen.end(), [&lastBefore](std::size_t a, std::size_t b) {
+            return lastBefore[a] < lastBefore[b];
+        });
+
+        //one entry per access time, set while that access is the latest to its line
+        std::vector<int> tree(seen.size() + 2 * static_cast<std::size_t>(last - first) + 1, 0);
+        auto treeAdd = [&tree](int t, int delta) {
+            for (auto k = static_cast<std::size_t>(t) + 1; k < tree.size(); k += k & (~k + 1)) tree[k] += delta;
+        };
+        auto treeSum = [&tree](int t) {
+            long long sum = 0;
+            for (auto k = static_cast<std::size_t>(t) + 1; k > 0; k -= k & (~k + 1)) sum += tree[k];
+            return sum;
+        };
+
+        std::vector<int> lastUse(lastBefore.size(), -1);
+        int time = 0;
+        for (std::size_t line : seen) {
+            for (auto &cache : caches) cache.access(static_cast<long long>(line));
+            treeAdd(time, 1);
+            lastUse[line] = time++;
         }
 
-        if (i+1 != end) {
-            if (rec) rec ->push_back(SStep{ACT_SWAP, i+1, end, 0});
-            std::swap(array[i+1],array[end]);
+        for (int k = first; k < last; ++k) {
+            ++report.steps;
+            const auto row = static_cast<int>(static_cast<long long>(k) * HEATMAP_ROWS / steps.size);
+            forEachAccess(steps[k], n, [&](int index, int) {
+                const std::size_t line = lineOf(index);
+                ++report.accesses;
+                ++report.heat[row][static_cast<long long>(index) * HEATMAP_COLUMNS / n];
+                for (std::size_t l = 0; l < caches.size(); ++l) {
+                    if (caches[l].access(static_cast<long long>(line))) break;
+                    ++report.misses[l];
+                }
+
+                const int previous = lastUse[line];
+                if (previous < 0) {
+                    ++report.cold;
+                } else {
+                    const auto distance = static_cast<unsigned long long>(treeSum(time - 1) - treeSum(previous));
+                    ++report.reuse[std::min(static_cast<int>(std::bit_width(distance)), REUSE_BUCKETS - 1)];
+                    treeAdd(previous, -1);
+                }
+                treeAdd(time, 1);
+                lastUse[line] = time++;
+            });
         }
+        return report;
+    }
+};
 
-        if (rec) rec-> push_back((SStep{ACT_HIGHLIGHT, i+1,-1,0}));
+//part / whole as a percentage with two decimals
+std::string formatPercent(long long part, long long whole) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2)
+         << (whole > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0) << "%";
+    return text.str();
+}
 
+//miss counts per level, the reuse distance histogram with the capacity of every level
+//marked, and the access heatmap (time downwards, index to the right)
+void printCacheReport(std::ostream &out, const SCacheReport &r, const std::vector<SCacheLevelConfig> &levels) {
+    out << r.steps << " steps, " << r.accesses << " accesses" << std::endl;
+    out << "level        bytes  ways      accesses        misses  miss rate" << std::endl;
+    long long reaching = r.accesses;
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+        out << std::left << std::setw(6) << levels[l].name << std::right
+            << std::setw(12) << levels[l].bytes << std::setw(6) << levels[l].ways
+            << std::setw(14) << reaching << std::setw(14) << r.misses[l]
+            << std::setw(11) << formatPercent(r.misses[l], reaching) << std::endl;
+        reaching = r.misses[l];
+    }
 
-        quickSortRecursive(array, start, i, rec);
-        quickSortRecursive(array, i+2, end, rec);
+    out << std::endl << "reuse distance (lines)      accesses  cumulative" << std::endl;
+    int top = REUSE_BUCKETS - 1;
+    while (top > 0 && r.reuse[top] == 0) --top;
+    long long cumulative = 0;
+    for (int b = 0; b <= top; ++b) {
+        cumulative += r.reuse[b];
+        const long long lo = b == 0 ? 0 : 1LL << (b - 1);
+        const long long hi = b == 0 ? 0 : (1LL << b) - 1;
+        std::string range = lo == hi ? std::to_string(lo) : std::to_string(lo) + "-" + std::to_string(hi);
+        for (auto &level : levels) {
+            const auto capacity = static_cast<long long>(level.bytes / CACHE_LINE_BYTES);
+            if (capacity >= lo && capacity <= hi) range += " (" + level.name + " size)";
+        }
+        out << std::left << std::setw(24) << range << std::right << std::setw(14) << r.reuse[b]
+            << std::setw(12) << formatPercent(cumulative, r.accesses) << std::endl;
     }
-};
+    out << std::left << std::setw(24) << "cold" << std::right << std::setw(14) << r.cold << std::endl;
+
+    static constexpr char SHADES[] = " .:-=+*#%@";
+    long long hottest = 1;
+    for (auto &row : r.heat) {
+        for (long long cell : row) hottest = std::max(hottest, cell);
+    }
+    out << std::endl << "accesses over time (down) and index (right)" << std::endl;
+    for (auto &row : r.heat) {
+        out << '|';
+        for (long long cell : row) {
+            out << SHADES[cell == 0 ? 0 : 1 + cell * 8 / hottest];
+        }
+        out << '|' << std::endl;
+    }
+}
 
 // -----------------------------
 // Visualizer classes
@@ -293,11 +1828,11 @@ public:
     int value;
     sf::RectangleShape shape;
     CBar(): value(0) {}
-    CBar(int v, float x, float y, float width): value(v) {
-        shape.setSize(sf::Vector2f(width, static_cast<float>(v)));
+    CBar(int v, float x, float y, float width, float scale = 1.0f): value(v) {
+        shape.setSize(sf::Vector2f(width, static_cast<float>(v) * scale));
         shape.setFillColor(sf::Color::Yellow);
         shape.setOutlineThickness(0.f);
-        shape.setPosition(x, y - static_cast<float>(v));
+        shape.setPosition(x, y - static_cast<float>(v) * scale);
     }
     void highlight(const sf::Color &c1, const sf::Color &c2, float thickness) {
         shape.setFillColor(c1);
@@ -306,26 +1841,61 @@ public:
     }
 };
 
+//below this bar width the visualizer switches to level of detail: every pixel column
+//stands for a range of indices and shows their mean as a bar, with a translucent
+//band from their minimum to their maximum
+constexpr float LOD_MIN_BAR_WIDTH = 1.0f;
+constexpr float LOD_COLUMN_WIDTH = 1.0f;
+constexpr std::uint8_t LOD_ENVELOPE_ALPHA = 90;
+
+struct SColumnStats {
+    int lo;
+    int hi;
+    long long sum;
+};
+
 class CSortingVisualizer {
 private:
     CBar* bars;
     int size;
+    float left;
     float barWidth;
     float baseY;
+    float valueScale;
+
+    //level of detail, used instead of bars when aggregated
+    bool aggregated;
+    int columns;
+    std::vector<int> values;
+    std::vector<SColumnStats> stats;
+    std::vector<sf::Color> columnColors;
+    //per column one quad for the mean bar and one for the min/max envelope
+    sf::VertexArray quads;
 
 public:
     CSortingVisualizer(const int* values, int n, float windowWidth, float windowHeight)
-        : bars(nullptr), size(n), barWidth(0.f), baseY(windowHeight - 50.0f) {
+        : CSortingVisualizer(values, n, LATERAL_MARGIN, windowHeight - 50.0f,
+                             windowWidth - 2.0f * LATERAL_MARGIN, 1.0f) {}
+
+    //bars fill [left, left + width) and stand on baseY, a value v is v * valueScale tall
+    CSortingVisualizer(const int* values, int n, float left, float baseY, float width, float valueScale)
+        : bars(nullptr), size(n), left(left), barWidth(0.f), baseY(baseY), valueScale(valueScale),
+          aggregated(false), columns(0), quads(sf::Quads) {
         if (n <= 0) {
             size = 0;
             bars = nullptr;
             return;
         }
-        barWidth = (windowWidth - 2.0f * LATERAL_MARGIN) / static_cast<float>(n);
+        barWidth = width / static_cast<float>(n);
+        if (barWidth < LOD_MIN_BAR_WIDTH) {
+            initColumns(values, width);
+            return;
+        }
+        float gap = std::min(SPACE_BETWEEN_BARS, barWidth / 4.0f);
         bars = new CBar[n];
         for (int i = 0; i < n; ++i) {
-            float x = LATERAL_MARGIN + static_cast<float>(i) * barWidth;
-            bars[i] = CBar(values[i], x, baseY, barWidth - SPACE_BETWEEN_BARS);
+            float x = left + static_cast<float>(i) * barWidth;
+            bars[i] = CBar(values[i], x, baseY, barWidth - gap, valueScale);
         }
     }
 
@@ -338,45 +1908,302 @@ public:
     CSortingVisualizer& operator=(CSortingVisualizer&&) = delete;
 
     void drawBars(sf::RenderWindow& window) const {
+        if (aggregated) {
+            window.draw(quads);
+            return;
+        }
         if (!bars) return;
         for (int i = 0; i < size; ++i) window.draw(bars[i].shape);
     }
 
-    void highlight(int index, const sf::Color &c1, const sf::Color &c2, float thickness) const  {
-        if (!bars || index < 0 || index >= size) return;
+    //with level of detail the whole column of the index takes the fill color
+    void highlight(int index, const sf::Color &c1, const sf::Color &c2, float thickness) {
+        if (index < 0 || index >= size) return;
+        if (aggregated) {
+            setColumnColor(columnOf(index), c1);
+            return;
+        }
         bars[index].highlight(c1, c2, thickness);
     }
 
+    void highlightAll(const sf::Color &c1, const sf::Color &c2, float thickness) {
+        if (aggregated) {
+            for (int c = 0; c < columns; ++c) setColumnColor(c, c1);
+            return;
+        }
+        for (int i = 0; i < size; ++i) bars[i].highlight(c1, c2, thickness);
+    }
+
     [[nodiscard]] float getBarX(int index) const {
-        if (!bars || index < 0 || index >= size) return 0.0f;
+        if (index < 0 || index >= size) return 0.0f;
+        if (aggregated) return left + static_cast<float>(columnOf(index)) * LOD_COLUMN_WIDTH;
         return bars[index].shape.getPosition().x;
     }
 
+    //columns do not slide, a swap shows up when it is finalized
     void setBarX(int index, float x) const {
-        if (!bars || index < 0 || index >= size) return;
-        bars[index].shape.setPosition(x, baseY - static_cast<float>(bars[index].value));
+        if (aggregated || index < 0 || index >= size) return;
+        bars[index].shape.setPosition(x, baseY - static_cast<float>(bars[index].value) * valueScale);
     }
 
-    void finalizeSwap(int i, int j) const {
-        if (!bars || i < 0 || j < 0 || i >= size || j >= size) return;
+    void finalizeSwap(int i, int j) {
+        if (i < 0 || j < 0 || i >= size || j >= size) return;
+        if (aggregated) {
+            int vi = values[i];
+            int vj = values[j];
+            setValue(i, vj);
+            setValue(j, vi);
+            return;
+        }
         CBar tmp = bars[i];
         bars[i] = bars[j];
         bars[j] = tmp;
-        float xi = LATERAL_MARGIN + static_cast<float>(i) * barWidth;
-        float xj = LATERAL_MARGIN + static_cast<float>(j) * barWidth;
-        bars[i].shape.setPosition(xi, baseY - static_cast<float>(bars[i].value));
-        bars[j].shape.setPosition(xj, baseY - static_cast<float>(bars[j].value));
+        float xi = left + static_cast<float>(i) * barWidth;
+        float xj = left + static_cast<float>(j) * barWidth;
+        bars[i].shape.setPosition(xi, baseY - static_cast<float>(bars[i].value) * valueScale);
+        bars[j].shape.setPosition(xj, baseY - static_cast<float>(bars[j].value) * valueScale);
     }
 
-    void overwriteValue(int index, int value) const{
-        if (!bars || index < 0 || index >= size) return;
+    void overwriteValue(int index, int value) {
+        if (index < 0 || index >= size) return;
+        if (aggregated) {
+            setValue(index, value);
+            return;
+        }
         bars[index].value = value;
-        bars[index].shape.setSize(sf::Vector2f(barWidth - SPACE_BETWEEN_BARS, static_cast<float>(value)));
-        float x = LATERAL_MARGIN + static_cast<float>(index) * barWidth;
-        bars[index].shape.setPosition(x, baseY - static_cast<float>(value));
+        float width = bars[index].shape.getSize().x;
+        bars[index].shape.setSize(sf::Vector2f(width, static_cast<float>(value) * valueScale));
+        float x = left + static_cast<float>(index) * barWidth;
+        bars[index].shape.setPosition(x, baseY - static_cast<float>(value) * valueScale);
     }
 
     [[nodiscard]] int getSize() const { return size; }
+    [[nodiscard]] bool isAggregated() const { return aggregated; }
+
+private:
+    void initColumns(const int* input, float width) {
+        aggregated = true;
+        columns = std::max(1, static_cast<int>(width / LOD_COLUMN_WIDTH));
+        values.assign(input, input + size);
+        stats.resize(static_cast<std::size_t>(columns));
+        columnColors.assign(static_cast<std::size_t>(columns), sf::Color::Yellow);
+        quads.resize(static_cast<std::size_t>(columns) * 8);
+        for (int c = 0; c < columns; ++c) {
+            recomputeColumn(c);
+        }
+    }
+
+    //index i belongs to column i * columns / size, so column c starts at the first
+    //index with i * columns >= c * size
+    [[nodiscard]] int columnOf(int index) const {
+        return static_cast<int>(static_cast<long long>(index) * columns / size);
+    }
+
+    [[nodiscard]] int columnStart(int c) const {
+        return static_cast<int>((static_cast<long long>(c) * size + columns - 1) / columns);
+    }
+
+    void recomputeColumn(int c) {
+        const int first = columnStart(c);
+        const int last = columnStart(c + 1);
+        SColumnStats &st = stats[c];
+        st = SColumnStats{values[first], values[first], 0};
+        for (int i = first; i < last; ++i) {
+            st.lo = std::min(st.lo, values[i]);
+            st.hi = std::max(st.hi, values[i]);
+            st.sum += values[i];
+        }
+        updateColumnQuads(c);
+    }
+
+    //a step changes one index, so only its column is updated; the column is only
+    //rescanned when the value that leaves it was its minimum or maximum
+    void setValue(int index, int value) {
+        const int old = values[index];
+        if (old == value) return;
+        values[index] = value;
+
+        const int c = columnOf(index);
+        SColumnStats &st = stats[c];
+        if ((old == st.lo && value > old) || (old == st.hi && value < old)) {
+            recomputeColumn(c);
+            return;
+        }
+        st.lo = std::min(st.lo, value);
+        st.hi = std::max(st.hi, value);
+        st.sum += static_cast<long long>(value) - old;
+        updateColumnQuads(c);
+    }
+
+    void setColumnColor(int c, const sf::Color &color) {
+        sf::Color &current = columnColors[c];
+        if (current == color) return;
+        current = color;
+        updateColumnQuads(c);
+    }
+
+    void updateColumnQuads(int c) {
+        const SColumnStats &st = stats[c];
+        const int count = columnStart(c + 1) - columnStart(c);
+        const float mean = static_cast<float>(static_cast<double>(st.sum) / count);
+        const float x0 = left + static_cast<float>(c) * LOD_COLUMN_WIDTH;
+        const float x1 = x0 + LOD_COLUMN_WIDTH;
+        const float yMean = baseY - mean * valueScale;
+        const float yLo = baseY - static_cast<float>(st.lo) * valueScale;
+        const float yHi = baseY - static_cast<float>(st.hi) * valueScale;
+
+        sf::Color fill = columnColors[c];
+        sf::Color band = fill;
+        band.a = LOD_ENVELOPE_ALPHA;
+
+        sf::Vertex* v = &quads[static_cast<std::size_t>(c) * 8];
+        v[0] = sf::Vertex(sf::Vector2f(x0, baseY), fill);
+        v[1] = sf::Vertex(sf::Vector2f(x1, baseY), fill);
+        v[2] = sf::Vertex(sf::Vector2f(x1, yMean), fill);
+        v[3] = sf::Vertex(sf::Vector2f(x0, yMean), fill);
+        v[4] = sf::Vertex(sf::Vector2f(x0, yLo), band);
+        v[5] = sf::Vertex(sf::Vector2f(x1, yLo), band);
+        v[6] = sf::Vertex(sf::Vector2f(x1, yHi), band);
+        v[7] = sf::Vertex(sf::Vector2f(x0, yHi), band);
+    }
+};
+
+//toggleable overlay with step counters, playback rate and frame times; the text is only
+//rebuilt a few times a second and only when one of the shown values changed
+constexpr int HUD_FRAME_SAMPLES = 240;
+constexpr int HUD_GRAPH_SAMPLES = 120;
+constexpr float HUD_REFRESH_INTERVAL = 0.25f;
+constexpr float HUD_WIDTH = 230.0f;
+constexpr float HUD_HEIGHT = 180.0f;
+constexpr float HUD_GRAPH_HEIGHT = 30.0f;
+
+class CPerfHud {
+private:
+    bool visible = false;
+    sf::Text text;
+    sf::RectangleShape background;
+    sf::VertexArray graph;
+    sf::Vector2f origin;
+
+    long long compares = 0;
+    long long swaps = 0;
+    long long overwrites = 0;
+    long long stepsSinceRate = 0;
+    float stepsPerSecond = 0.0f;
+
+    float frameTimes[HUD_FRAME_SAMPLES]{};
+    int frameCount = 0;
+    int frameHead = 0;
+    float p50 = 0.0f;
+    float p99 = 0.0f;
+
+    sf::Clock refreshClock;
+    std::string shown;
+
+public:
+    CPerfHud(): graph(sf::Lines, 2 * HUD_GRAPH_SAMPLES) {}
+
+    void init(const sf::Font& font, float x, float y) {
+        origin = sf::Vector2f(x, y);
+        text.setFont(font);
+        text.setCharacterSize(13);
+        text.setFillColor(sf::Color::White);
+        text.setPosition(x + 8.0f, y + 6.0f);
+        background.setFillColor(sf::Color(0, 0, 0, 170));
+        background.setOutlineColor(sf::Color(255, 255, 255, 90));
+        background.setOutlineThickness(1.0f);
+        background.setPosition(x, y);
+        background.setSize(sf::Vector2f(HUD_WIDTH, HUD_HEIGHT));
+    }
+
+    void toggle() { visible = !visible; shown.clear(); }
+    [[nodiscard]] bool isVisible() const { return visible; }
+
+    void resetCounters() {
+        compares = swaps = overwrites = 0;
+        stepsSinceRate = 0;
+        stepsPerSecond = 0.0f;
+        refreshClock.restart();
+    }
+
+    void onStep(const SStep& s) {
+        switch (s.kind) {
+            case ACT_COMPARE: ++compares; break;
+            case ACT_SWAP: ++swaps; break;
+            case ACT_OVERWRITE: ++overwrites; break;
+            case ACT_HIGHLIGHT: break;
+        }
+        ++stepsSinceRate;
+    }
+
+    void recordFrame(float seconds) {
+        frameTimes[frameHead] = seconds;
+        frameHead = (frameHead + 1) % HUD_FRAME_SAMPLES;
+        if (frameCount < HUD_FRAME_SAMPLES) ++frameCount;
+    }
+
+    //called once per frame; cheap unless the refresh interval has passed
+    void update(long long position, long long total, bool totalFinal, std::size_t traceBytes) {
+        float elapsed = refreshClock.getElapsedTime().asSeconds();
+        if (elapsed < HUD_REFRESH_INTERVAL) return;
+        refreshClock.restart();
+
+        stepsPerSecond = static_cast<float>(stepsSinceRate) / elapsed;
+        stepsSinceRate = 0;
+        if (!visible) return;
+
+        updatePercentiles();
+        updateGraph();
+
+        std::ostringstream ss;
+        ss << "compares   " << compares << "\n"
+           << "swaps      " << swaps << "\n"
+           << "overwrites " << overwrites << "\n"
+           << "step       " << position << " / " << total << (totalFinal ? "" : "+") << "\n"
+           << "steps/s    " << std::lround(stepsPerSecond) << "\n"
+           << "frame p50  " << std::fixed << std::setprecision(2) << p50 * 1000.0f << " ms\n"
+           << "frame p99  " << p99 * 1000.0f << " ms\n"
+           << "trace mem  " << std::setprecision(1) << static_cast<double>(traceBytes) / 1024.0 << " KiB";
+        std::string next = ss.str();
+        if (next != shown) {
+            shown = std::move(next);
+            text.setString(shown);
+        }
+    }
+
+    void draw(sf::RenderWindow& window) const {
+        if (!visible) return;
+        window.draw(background);
+        window.draw(text);
+        window.draw(graph);
+    }
+
+private:
+    void updatePercentiles() {
+        if (frameCount == 0) return;
+        float sorted[HUD_FRAME_SAMPLES];
+        std::copy(frameTimes, frameTimes + frameCount, sorted);
+        int i50 = frameCount / 2;
+        int i99 = std::min(frameCount - 1, frameCount * 99 / 100);
+        std::nth_element(sorted, sorted + i50, sorted + frameCount);
+        p50 = sorted[i50];
+        std::nth_element(sorted, sorted + i99, sorted + frameCount);
+        p99 = sorted[i99];
+    }
+
+    //one vertical line per recent frame, 1 pixel per millisecond, red above 1/30 s
+    void updateGraph() {
+        float baseY = origin.y + HUD_HEIGHT - 4.0f;
+        for (int k = 0; k < HUD_GRAPH_SAMPLES; ++k) {
+            int sample = (frameHead - HUD_GRAPH_SAMPLES + k + 2 * HUD_FRAME_SAMPLES) % HUD_FRAME_SAMPLES;
+            float ms = k < HUD_GRAPH_SAMPLES - frameCount ? 0.0f : frameTimes[sample] * 1000.0f;
+            float h = std::min(ms, HUD_GRAPH_HEIGHT);
+            sf::Color c = ms > 1000.0f / 30.0f ? sf::Color(255, 90, 90) : sf::Color(120, 220, 120);
+            float x = origin.x + 8.0f + static_cast<float>(k) * (HUD_WIDTH - 16.0f) / HUD_GRAPH_SAMPLES;
+            graph[2 * k] = sf::Vertex(sf::Vector2f(x, baseY), c);
+            graph[2 * k + 1] = sf::Vertex(sf::Vector2f(x, baseY - h), c);
+        }
+    }
 };
 
 // -----------------------------
@@ -395,18 +2222,29 @@ private:
     sf::Text startText;
 
     // menu
-    static constexpr int NUM_METHODS = 5;
+    static constexpr int NUM_METHODS = 13;
+    static constexpr int MENU_MAX_ROWS = 7;
+    static constexpr int MENU_ROWS = NUM_METHODS < MENU_MAX_ROWS ? NUM_METHODS : MENU_MAX_ROWS;
+    static constexpr int MENU_COLUMNS = (NUM_METHODS + MENU_MAX_ROWS - 1) / MENU_MAX_ROWS;
     std::string methods[NUM_METHODS] = {
         "Insertion Sort", "Selection Sort",
-        "Quick Sort", "Merge Sort", "Heap Sort"
+        "Quick Sort", "Merge Sort", "Heap Sort",
+        "Quick Sort (3-way)", "Counting Sort", "In-place Merge",
+        "Bitonic Sort", "Odd-even Merge",
+        "Auto", "Race (all)", "Incremental"
     };
+    static constexpr int METHOD_AUTO = 10;
+    static constexpr int METHOD_RACE = 11;
+    static constexpr int METHOD_INCREMENTAL = 12;
     sf::RectangleShape buttons[NUM_METHODS];
     sf::Text texts[NUM_METHODS];
 
     int methodSelected = -1;
+    std::string sortingTitle;
+    std::string sortingNote;
 
-    SStepBuffer steps;
-    int playIndex = 0;
+    CAsyncRecording recording;
+    long long playIndex = 0;
     float stepInterval = 0.08f;
     sf::Clock stepClock;
     bool recorded = false;
@@ -432,6 +2270,9 @@ private:
     int highlightsCount = 0;
 
 
+    static constexpr int COMPLETION_MAX_STEPS = 100;
+    static constexpr int PLAYBACK_MAX_STEPS_PER_FRAME = 1 << 14;
+
     struct CompletionAnim {
         bool active = false;
         int currentIndex = 0;
@@ -450,13 +2291,40 @@ private:
     sf::Color sortedColor = sf::Color(80, 200, 80);
     sf::Color finalGreenColor = sf::Color(50, 150, 50);
 
+    struct SRaceLane {
+        int method = 0;
+        std::vector<int> values;
+        SStepBuffer steps;
+        std::future<void> recording;
+        bool ready = false;
+        bool finished = false;
+        int position = 0;
+        int lastA = -1, lastB = -1;
+        std::unique_ptr<CSortingVisualizer> visual;
+        sf::Text label;
+        std::string shownLabel;
+    };
+    static constexpr int RACE_LANES = NUM_RECORDED_METHODS;
+    static constexpr int RACE_COLUMNS = 5;
+    //one per lane, reused by every race; declared first so the lanes go before them
+    CArena raceArenas[RACE_LANES];
+    std::vector<std::unique_ptr<SRaceLane>> raceLanes;
+    bool raceActive = false;
+    int raceTick = 0;
+
+    CPerfHud hud;
+    sf::Clock frameClock;
+
     std::unique_ptr<CSortingVisualizer> visual;
-    int currentArrayValues[CONST_MAX_LENGTH]{};
+    std::vector<int> currentArrayValues;
     int currentN = 0;
+    int sizeIndex = 0;
 
-    //used for random number gen
+    //used for random number gen, every sort gets a fresh seed that is shown on screen
     std::random_device rd;
-    std::mt19937 gen;
+    DistKind distribution = DIST_UNIFORM;
+    std::uint64_t currentSeed = 0;
+    sf::Text distText;
 
     //for handle menu event ux
     int menuCursor = 0;
@@ -476,8 +2344,9 @@ private:
 public:
     CApp() : window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "DSA"),
              currentState(Welcome),
-             gen(rd()),menuCursor(0) {
+             menuCursor(0) {
         centerWindow();
+        window.setFramerateLimit(ANIMATION_FRAME_LIMIT);
         if (!font.loadFromFile("DejaVuSans.ttf")) {
             std::cerr << "Could not load font! (place DejaVuSans.ttf next to exe)\n";
             //continue anyway
@@ -495,19 +2364,24 @@ public:
         startText.setFillColor(DARK_BLUE);
         centerText(startText, startButton);
 
+        //buttons are laid out column by column, MENU_MAX_ROWS per column
         for (int i = 0; i < NUM_METHODS; ++i) {
             float buttonWidth = 300;
-            float buttonHeight = 50;
-            float spacing = 20;
+            float buttonHeight = 44;
+            float spacing = 10;
             float startY = 160;
+            float gridWidth = MENU_COLUMNS * buttonWidth + (MENU_COLUMNS - 1) * spacing;
+            int column = i / MENU_ROWS;
+            int row = i % MENU_ROWS;
 
             buttons[i].setSize(sf::Vector2f(buttonWidth, buttonHeight));
             buttons[i].setFillColor(sf::Color::Yellow);
             buttons[i].setOutlineColor(sf::Color::Cyan);
             buttons[i].setOutlineThickness(2);
             buttons[i].setPosition(
-                static_cast<float>(window.getSize().x) / 2.0f - buttonWidth / 2.0f,
-                startY + static_cast<float>(i) * (buttonHeight + spacing)
+                static_cast<float>(window.getSize().x) / 2.0f - gridWidth / 2.0f
+                    + static_cast<float>(column) * (buttonWidth + spacing),
+                startY + static_cast<float>(row) * (buttonHeight + spacing)
             );
 
             texts[i].setFont(font);
@@ -517,6 +2391,13 @@ public:
             centerText(texts[i], buttons[i]);
         }
 
+        hud.init(font, WINDOW_WIDTH - HUD_WIDTH - 10.0f, 115.0f);
+
+        distText.setFont(font);
+        distText.setCharacterSize(18);
+        distText.setFillColor(sf::Color::White);
+        updateDistText();
+
         updateDurations();
     }
 
@@ -527,6 +2408,14 @@ public:
         window.setPosition(sf::Vector2i(posX, posY));
     }
 
+    void updateDistText() {
+        distText.setString(std::string("Input: ") + DIST_NAMES[distribution] + ", "
+            + std::to_string(ARRAY_SIZES[sizeIndex]) + " values  (\"D\" / \"N\" to change)");
+        sf::FloatRect bounds = distText.getLocalBounds();
+        distText.setOrigin(bounds.left + bounds.width / 2.0f, bounds.top + bounds.height / 2.0f);
+        distText.setPosition(static_cast<float>(WINDOW_WIDTH) / 2.0f, 125.0f);
+    }
+
     static void centerText(sf::Text &text, const sf::RectangleShape &rect) {
         sf::FloatRect textBounds = text.getLocalBounds();
         text.setOrigin(textBounds.left + textBounds.width / 2.0f,
@@ -536,15 +2425,55 @@ public:
                          rectBounds.top + rectBounds.height / 2.0f);
     }
 
+    //a frame is drawn after input or while something animates. Otherwise the loop
+    //sleeps in waitEvent, so the welcome screen, the menu and a paused or finished
+    //sort use no CPU, and the next key press still wakes it right away
     void run() {
+        CProfiler::nameThread("ui");
+        bool dirty = true;
         while (window.isOpen()) {
             sf::Event event{};
-            while (window.pollEvent(event)) handleEvent(event);
+            if (!dirty && !isAnimating()) {
+                if (!window.waitEvent(event)) continue;
+                CZone zone("events");
+                handleEvent(event);
+                dirty = true;
+                //time spent waiting is not frame time
+                frameClock.restart();
+            }
+            {
+                CZone zone("events");
+                while (window.pollEvent(event)) {
+                    handleEvent(event);
+                    dirty = true;
+                }
+            }
+
+            //decided before the update, so the frame that ends an animation is drawn
+            bool animating = isAnimating();
+            if (currentState == Sorting) {
+                CZone zone("updateSorting");
+                updateSorting();
+            }
 
-            if (currentState == Sorting) updateSorting();
+            if (dirty || animating) {
+                render();
+                hud.recordFrame(frameClock.restart().asSeconds());
+            }
+            dirty = false;
+        }
+    }
 
-            render();
+    //true while the sorting screen keeps changing without input
+    bool isAnimating() const {
+        if (currentState != Sorting || paused) return false;
+        if (raceActive) {
+            for (auto &lane : raceLanes) {
+                if (!lane->finished) return true;
+            }
+            return false;
         }
+        return recorded || swapAnim.active || completionAnim.active || highlightsCount > 0;
     }
 
     void handleEvent(const sf::Event& event) {
@@ -563,12 +2492,15 @@ public:
     }
 
     void render() {
+        CZone zone("render");
         window.clear(DARK_BLUE);
         switch (currentState) {
             case Welcome: renderWelcome(); break;
             case Menu: renderMenu(); break;
             case Sorting: renderSorting(); break;
         }
+        //includes the wait for the frame rate limit
+        CZone displayZone("display");
         window.display();
     }
 
@@ -614,6 +2546,12 @@ private:
             } else if (event.key.code == sf::Keyboard::Up) {
                 menuCursor = (menuCursor - 1 + NUM_METHODS) % NUM_METHODS;
 
+                updateMenuColors();
+            } else if (event.key.code == sf::Keyboard::Right && menuCursor + MENU_ROWS < NUM_METHODS) {
+                menuCursor += MENU_ROWS;
+                updateMenuColors();
+            } else if (event.key.code == sf::Keyboard::Left && menuCursor - MENU_ROWS >= 0) {
+                menuCursor -= MENU_ROWS;
                 updateMenuColors();
             } else if (event.key.code == sf::Keyboard::Enter) {
                 methodSelected = menuCursor;
@@ -624,6 +2562,12 @@ private:
                 currentState=Welcome;
                 menuCursor = 0;
                 return;
+            } else if (event.key.code == sf::Keyboard::D) {
+                distribution = static_cast<DistKind>((distribution + 1) % DIST_COUNT);
+                updateDistText();
+            } else if (event.key.code == sf::Keyboard::N) {
+                sizeIndex = (sizeIndex + 1) % NUM_ARRAY_SIZES;
+                updateDistText();
             }
         }
 
@@ -686,6 +2630,8 @@ private:
                 || event.key.code == sf::Keyboard::P) {
                 togglePause();
                 return;
+            } else if (event.key.code == sf::Keyboard::H) {
+                hud.toggle();
             }
 
 
@@ -739,9 +2685,10 @@ private:
 
         sf::Text goBackText("Press \"B\" for going back" , font, 18);
         goBackText.setFillColor(sf::Color::White);
-        goBackText.setPosition(287,510);
+        goBackText.setPosition(287,550);
 
         window.draw(title);
+        window.draw(distText);
         for (int i = 0; i < NUM_METHODS; ++i) {
             window.draw(buttons[i]);
             window.draw(texts[i]);
@@ -754,7 +2701,11 @@ private:
     }
 
     void renderSorting() {
-        sf::Text title(methods[methodSelected], font, 42);
+        if (raceActive) {
+            renderRace();
+            return;
+        }
+        sf::Text title(sortingTitle, font, sortingTitle.size() > 20 ? 32 : 42);
         title.setFillColor(sf::Color::White);
         title.setPosition(20, 20);
 
@@ -784,6 +2735,12 @@ private:
         speedText.setFillColor(sf::Color::White);
         speedText.setPosition(20,70);
 
+        sf::Text inputText(std::string("Input: ") + DIST_NAMES[distribution]
+            + ", seed " + std::to_string(currentSeed)
+            + (sortingNote.empty() ? "" : ", " + sortingNote), font, 14);
+        inputText.setFillColor(sf::Color::White);
+        inputText.setPosition(20,92);
+
 
         window.draw(title);
         window.draw(subtitle);
@@ -791,6 +2748,10 @@ private:
             visual->drawBars(window);
         }
         window.draw(speedText);
+        window.draw(inputText);
+
+        hud.update(playIndex, recording.producedSteps(), recording.complete(), recording.bytes());
+        hud.draw(window);
     }
 
     static float linearInterpolate(float a, float b, float t) {
@@ -836,11 +2797,7 @@ private:
 
         switch (s.kind) {
             case ACT_COMPARE:
-                for (int k = 0; k < visual->getSize(); ++k) {
-                    if (k != s.i && k != s.j) {
-                        visual->highlight(k, defaultBarColor, sf::Color::Transparent, 0.0f);
-                    }
-                }
+                visual->highlightAll(defaultBarColor, sf::Color::Transparent, 0.0f);
 
                 if (s.i >= 0) {
                     visual->highlight(s.i, compareColorA, sf::Color::White, 3.0f);
@@ -860,13 +2817,18 @@ private:
                 visual->overwriteValue(s.i, s.value);
                 break;
             case ACT_SWAP:
-                // swaps handled in animation block
+                //only reached without a swap animation (level of detail)
+                visual->finalizeSwap(s.i, s.j);
                 break;
         }
     }
 
 
     void updateSorting() {
+        if (raceActive) {
+            updateRace();
+            return;
+        }
         if (!visual) return;
 
         if (paused) return;
@@ -885,8 +2847,9 @@ private:
             return;
         }
         float elapsedStep = stepAccElapsed + stepClock.getElapsedTime().asSeconds();
-        if (playIndex >= steps.size) {
+        if (recording.exhausted()) {
             if (recorded) {
+                recorded = false;
                 startCompletionAnimation();
             }
             return;
@@ -895,16 +2858,23 @@ private:
 
         if (elapsedStep < stepInterval) return;
 
-        SStep s = steps.data[playIndex];
-
-        if (s.kind == ACT_SWAP) {
-            startSwapAnimation(s);
-        } else {
+        //when the step interval is shorter than a frame, every step that came due since
+        //the last frame is played now; a swap that gets animated ends the batch
+        int due = std::min(static_cast<int>(elapsedStep / stepInterval), PLAYBACK_MAX_STEPS_PER_FRAME);
+        for (int k = 0; k < due; ++k) {
+            //playback caught up with the producer, try again next frame
+            SStep s{};
+            if (!recording.next(s)) break;
+            hud.onStep(s);
+            ++playIndex;
+
+            if (s.kind == ACT_SWAP && !visual->isAggregated()) {
+                startSwapAnimation(s);
+                break;
+            }
             applyStepImmediate(s);
         }
 
-        ++playIndex;
-
         stepAccElapsed = 0.0f;
         stepClock.restart();
     }
@@ -917,9 +2887,7 @@ private:
         completionAnim.clock.restart();
 
         // Clear all highlights first
-        for (int i = 0; i < visual->getSize(); ++i) {
-            visual->highlight(i, defaultBarColor, sf::Color::Transparent, 0.0f);
-        }
+        visual->highlightAll(defaultBarColor, sf::Color::Transparent, 0.0f);
     }
 
     void updateCompletionAnimation() {
@@ -928,19 +2896,23 @@ private:
         float elapsed = completionAnim.accElapsed + completionAnim.clock.getElapsedTime().asSeconds();
         if (elapsed >= completionAnim.highlightDuration) {
 
-            if (completionAnim.currentIndex < visual->getSize()) {
-                visual->highlight(completionAnim.currentIndex, finalGreenColor, sf::Color::White, 2.0f);
-                if (completionAnim.currentIndex > 0) {
-                    visual->highlight(completionAnim.currentIndex - 1, sortedColor, sf::Color::Transparent, 0.0f);
+            //large arrays are swept in COMPLETION_MAX_STEPS groups of bars
+            const int n = visual->getSize();
+            const int stride = std::max(1, n / COMPLETION_MAX_STEPS);
+            if (completionAnim.currentIndex < n) {
+                const int first = completionAnim.currentIndex;
+                for (int i = std::max(first - stride, 0); i < first; ++i) {
+                    visual->highlight(i, sortedColor, sf::Color::Transparent, 0.0f);
                 }
-                completionAnim.currentIndex++;
+                for (int i = first; i < std::min(first + stride, n); ++i) {
+                    visual->highlight(i, finalGreenColor, sf::Color::White, 2.0f);
+                }
+                completionAnim.currentIndex += stride;
 
                 completionAnim.accElapsed = 0.0f;
                 completionAnim.clock.restart();
             } else {
-                for (int i = 0; i < visual->getSize(); ++i) {
-                    visual->highlight(i, sortedColor, sf::Color::Transparent, 0.0f);
-                }
+                visual->highlightAll(sortedColor, sf::Color::Transparent, 0.0f);
                 completionAnim.active = false;
                 completionAnim.accElapsed = 0.0f;
             }
@@ -979,74 +2951,207 @@ private:
     }
 
     void prepareSorting(int method) {
-        currentN = NUMBER_OF_COLUMNS;  // Increased for better visual effect
-        std::uniform_int_distribution<> dis(20, 419);
-        for (int k = 0; k < currentN; ++k) {
-            currentArrayValues[k] = dis(gen);
+        if (method == METHOD_RACE) {
+            cleanupSorting();
+            prepareRace();
+            return;
+        }
+        currentN = ARRAY_SIZES[sizeIndex];
+        currentSeed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+        currentArrayValues.resize(currentN);
+        CInputGenerator(distribution, currentSeed, 20, 419).fill(currentArrayValues.data(), currentN);
+
+        sortingTitle = methods[method];
+        sortingNote.clear();
+        if (method == METHOD_AUTO) {
+            //map the chosen engine back onto its menu entry
+            static constexpr int ENGINE_METHODS[] = {0, 6, 3, 5};
+            SAutoDecision d = CAutoSorter::decide(currentArrayValues.data(), currentN);
+            method = ENGINE_METHODS[d.engine];
+            sortingTitle = "Auto: " + methods[method];
+            sortingNote = std::string("picked for: ") + d.reason + " (~" + std::to_string(d.runs) + " runs, range "
+                + std::to_string(d.range) + ", ~" + std::to_string(static_cast<int>(d.duplicateRatio * 100.0)) + "% duplicates)";
         }
 
-        steps.clear();
-
-        CSorter s(currentArrayValues, currentN);
-
-        switch (method) {
-            case 0: {
-                // Insertion Sort
-                s.insertionSort(&steps);
-                recorded = true;
-                break;
-            }
-            case 1: {
-                // Selection Sort
-                s.selectionSort(&steps);
-                recorded = true;
-                break;
-            }
-            case 2: {
-                // Quick Sort
-                CQuickSorter qs(currentArrayValues, currentN);
-                qs.quickSort(&steps);
-                recorded = true;
-                break;
-            }
-            case 3: {
-                // Merge Sort
-                CMergeSorter ms(currentArrayValues, currentN);
-                ms.mergeSort(&steps);
-                recorded = true;
-                break;
-            }
-            case 4: {
-                // Heap Sort
-                CHeapSorter hs(currentArrayValues, currentN);
-                hs.heapSort(&steps);
-                recorded = true;
-                break;
-            }
-            default: {
-                s.selectionSort(&steps);
-                recorded = true;
-                break;
-            }
+        //recording runs on its own thread, playback starts with the first batch
+        if (method == METHOD_INCREMENTAL) {
+            std::vector<int> changed = makeResortInput(currentArrayValues, currentSeed, 20, 419);
+            sortingNote = std::to_string(changed.size()) + " of " + std::to_string(currentN) + " values changed since the last sort";
+            recording.start([changed, values = currentArrayValues](SStepBuffer &rec, CArena &arena) {
+                CMergeSorter ms(values.data(), static_cast<int>(values.size()), arena);
+                ms.resortChanged(changed, rec);
+            });
+        } else {
+            recording.start([method, values = currentArrayValues](SStepBuffer &rec, CArena &arena) mutable {
+                recordSteps(method, values.data(), static_cast<int>(values.size()), rec, arena);
+            });
         }
+        recorded = true;
 
         visual = std::make_unique<CSortingVisualizer>(
-            currentArrayValues,
+            currentArrayValues.data(),
             currentN,
             static_cast<float>(WINDOW_WIDTH),
             static_cast<float>(WINDOW_HEIGHT)
         );
 
         playIndex = 0;
+        hud.resetCounters();
         stepClock.restart();
         swapAnim.active = false;
         completionAnim.active = false;
         highlightsCount = 0;
     }
 
+    //race: every engine sorts the same input in its own pane; traces are recorded on
+    //worker threads and a pane joins the shared timeline as soon as its trace is ready
+    void prepareRace() {
+        cleanupRace();
+        currentN = NUMBER_OF_COLUMNS;
+        currentSeed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+        currentArrayValues.resize(currentN);
+        CInputGenerator(distribution, currentSeed, 20, 419).fill(currentArrayValues.data(), currentN);
+
+        sortingTitle = "Race";
+        sortingNote.clear();
+        raceActive = true;
+        raceTick = 0;
+
+        const float top = 125.0f;
+        const float bottom = static_cast<float>(WINDOW_HEIGHT) - 10.0f;
+        const float gridLeft = 20.0f;
+        const float gridWidth = static_cast<float>(WINDOW_WIDTH) - 40.0f;
+        const int rows = (RACE_LANES + RACE_COLUMNS - 1) / RACE_COLUMNS;
+        const float paneWidth = gridWidth / RACE_COLUMNS;
+        const float paneHeight = (bottom - top) / static_cast<float>(rows);
+        const float scale = (paneHeight - 42.0f) / 420.0f;
+
+        for (int k = 0; k < RACE_LANES; ++k) {
+            auto lane = std::make_unique<SRaceLane>();
+            lane->method = k;
+            lane->values = currentArrayValues;
+            raceArenas[k].reset();
+            lane->steps.arena = &raceArenas[k];
+
+            float x = gridLeft + static_cast<float>(k % RACE_COLUMNS) * paneWidth;
+            float y = top + static_cast<float>(k / RACE_COLUMNS) * paneHeight;
+            lane->visual = std::make_unique<CSortingVisualizer>(
+                lane->values.data(), currentN, x + 6.0f, y + paneHeight - 6.0f, paneWidth - 12.0f, scale);
+            lane->label.setFont(font);
+            lane->label.setCharacterSize(13);
+            lane->label.setFillColor(sf::Color::White);
+            lane->label.setPosition(x + 6.0f, y + 2.0f);
+            lane->label.setString(methods[k] + "\nrecording...");
+
+            SRaceLane* l = lane.get();
+            lane->recording = std::async(std::launch::async, [l, n = currentN]() {
+                CProfiler::nameThread("race lane");
+                std::vector<int> input = l->values;
+                recordSteps(l->method, input.data(), n, l->steps, *l->steps.arena);
+            });
+            raceLanes.push_back(std::move(lane));
+        }
+
+        stepClock.restart();
+        stepAccElapsed = 0.0f;
+    }
+
+    void updateRace() {
+        if (paused) return;
+
+        for (auto &lane : raceLanes) {
+            if (!lane->ready && lane->recording.valid() &&
+                lane->recording.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                lane->recording.get();
+                lane->ready = true;
+            }
+        }
+
+        float elapsedStep = stepAccElapsed + stepClock.getElapsedTime().asSeconds();
+        if (elapsedStep < stepInterval) return;
+        stepAccElapsed = 0.0f;
+        stepClock.restart();
+
+        //the timeline only starts once some pane can move
+        bool anyReady = false;
+        for (auto &lane : raceLanes) anyReady = anyReady || lane->ready;
+        if (!anyReady) return;
+        ++raceTick;
+
+        for (auto &lane : raceLanes) {
+            if (!lane->ready) continue;
+            //a pane that became ready late catches up to the shared timeline
+            while (lane->position < raceTick && lane->position < lane->steps.size) {
+                applyRaceStep(*lane, lane->steps[lane->position]);
+                ++lane->position;
+            }
+            if (lane->position >= lane->steps.size && !lane->finished) {
+                lane->finished = true;
+                lane->visual->highlightAll(sortedColor, sf::Color::Transparent, 0.0f);
+            }
+            updateRaceLabel(*lane);
+        }
+    }
+
+    void applyRaceStep(SRaceLane &lane, const SStep &s) const {
+        CSortingVisualizer &v = *lane.visual;
+        if (lane.lastA >= 0) v.highlight(lane.lastA, defaultBarColor, sf::Color::Transparent, 0.0f);
+        if (lane.lastB >= 0) v.highlight(lane.lastB, defaultBarColor, sf::Color::Transparent, 0.0f);
+        lane.lastA = lane.lastB = -1;
+
+        switch (s.kind) {
+            case ACT_COMPARE:
+                if (s.i >= 0) v.highlight(s.i, compareColorA, sf::Color::Transparent, 0.0f);
+                if (s.j >= 0) v.highlight(s.j, compareColorB, sf::Color::Transparent, 0.0f);
+                lane.lastA = s.i;
+                lane.lastB = s.j;
+                break;
+            case ACT_SWAP:
+                v.finalizeSwap(s.i, s.j);
+                break;
+            case ACT_OVERWRITE:
+                v.overwriteValue(s.i, s.value);
+                break;
+            case ACT_HIGHLIGHT:
+                v.highlight(s.i, sortedColor, sf::Color::Transparent, 0.0f);
+                break;
+        }
+    }
+
+    void updateRaceLabel(SRaceLane &lane) const {
+        std::string label = methods[lane.method] + "\nstep " + std::to_string(lane.position)
+            + " / " + std::to_string(lane.steps.size) + (lane.finished ? "  done" : "");
+        if (label != lane.shownLabel) {
+            lane.shownLabel = label;
+            lane.label.setString(label);
+        }
+    }
+
+    void renderRace() {
+        sf::Text title("Race: same input, shared timeline", font, 32);
+        title.setFillColor(sf::Color::White);
+        title.setPosition(20, 20);
+        window.draw(title);
+
+        for (auto &lane : raceLanes) {
+            lane->visual->drawBars(window);
+            window.draw(lane->label);
+        }
+    }
+
+    void cleanupRace() {
+        for (auto &lane : raceLanes) {
+            if (lane->recording.valid()) lane->recording.wait();
+        }
+        raceLanes.clear();
+        raceActive = false;
+        raceTick = 0;
+    }
+
     void cleanupSorting() {
+        cleanupRace();
+        recording.stop();
         visual.reset();
-        steps.clear();
         playIndex = 0;
         recorded = false;
         swapAnim.active = false;
@@ -1140,8 +3245,220 @@ private:
 // -----------------------------
 // main
 // -----------------------------
-int main() {
-    CApp app;
-    app.run();
+//position of name in names, count when it is not there
+int findName(const char* name, const char* const names[], int count) {
+    for (int k = 0; k < count; ++k) {
+        if (std::strcmp(name, names[k]) == 0) return k;
+    }
+    return count;
+}
+
+//without a window: --steps prints how many steps of each kind every method records,
+//--trace streams the steps of one method to stdout
+int runHeadless(int argc, char* argv[]) {
+    const bool trace = std::strcmp(argv[1], "--trace") == 0;
+    int arg = 2;
+    int method = 0;
+    if (trace) {
+        if (argc <= arg || (method = findName(argv[arg], RECORDED_METHOD_NAMES, NUM_RECORDED_METHODS)) == NUM_RECORDED_METHODS) {
+            std::cerr << "usage: sfml_practice --trace <method> [distribution] [n] [seed], method one of:";
+            for (auto name : RECORDED_METHOD_NAMES) std::cerr << " " << name;
+            std::cerr << std::endl;
+            return 1;
+        }
+        ++arg;
+    }
+
+    DistKind dist = DIST_UNIFORM;
+    if (argc > arg) {
+        dist = static_cast<DistKind>(findName(argv[arg], DIST_NAMES, DIST_COUNT));
+        if (dist == DIST_COUNT) {
+            std::cerr << "Unknown distribution \"" << argv[arg] << "\"" << std::endl;
+            return 1;
+        }
+    }
+    int n = argc > arg + 1 ? std::max(std::atoi(argv[arg + 1]), 1) : NUMBER_OF_COLUMNS;
+    std::uint64_t seed = argc > arg + 2 ? std::strtoull(argv[arg + 2], nullptr, 10) : 42;
+
+    std::vector<int> values(static_cast<std::size_t>(n));
+    CInputGenerator(dist, seed, 20, 419).fill(values.data(), n);
+
+    CArena arena;
+    if (trace) {
+        CTraceWriter writer(std::cout);
+        recordSteps(method, values.data(), n, writer, arena);
+        return 0;
+    }
+
+    std::cout << std::left << std::setw(METHOD_COLUMN_WIDTH) << "method" << std::right << std::setw(10) << "compares"
+              << std::setw(10) << "swaps" << std::setw(12) << "overwrites" << std::setw(12) << "highlights" << std::endl;
+    for (int m = 0; m < NUM_RECORDED_METHODS; ++m) {
+        SStepCounter counter;
+        std::vector<int> input = values;
+        arena.reset();
+        recordSteps(m, input.data(), n, counter, arena);
+        std::cout << std::left << std::setw(METHOD_COLUMN_WIDTH) << RECORDED_METHOD_NAMES[m] << std::right
+                  << std::setw(10) << counter.counts[ACT_COMPARE]
+                  << std::setw(10) << counter.counts[ACT_SWAP]
+                  << std::setw(12) << counter.counts[ACT_OVERWRITE]
+                  << std::setw(12) << counter.counts[ACT_HIGHLIGHT] << std::endl;
+    }
+    return 0;
+}
+
+//bytes with an optional K, M or G suffix, 0 when malformed
+std::size_t parseBytes(const char* text) {
+    char* end = nullptr;
+    std::size_t bytes = std::strtoull(text, &end, 10);
+    switch (*end) {
+        case 'K': case 'k': bytes <<= 10; ++end; break;
+        case 'M': case 'm': bytes <<= 20; ++end; break;
+        case 'G': case 'g': bytes <<= 30; ++end; break;
+        default: break;
+    }
+    return *end == '\0' ? bytes : 0;
+}
+
+//"32K/8,1M/16,8M/16" is a 32 KiB 8-way L1, a 1 MiB 16-way L2 and so on; the last
+//level is called LLC
+bool parseCacheLevels(const std::string &spec, std::vector<SCacheLevelConfig> &levels) {
+    levels.clear();
+    std::istringstream in(spec);
+    for (std::string level; std::getline(in, level, ','); ) {
+        const auto slash = level.find('/');
+        if (slash == std::string::npos) return false;
+        const std::size_t bytes = parseBytes(level.substr(0, slash).c_str());
+        const int ways = std::atoi(level.c_str() + slash + 1);
+        if (bytes < CACHE_LINE_BYTES || ways <= 0) return false;
+        levels.push_back(SCacheLevelConfig{"L" + std::to_string(levels.size() + 1), bytes, ways});
+    }
+    if (levels.empty() || levels.size() > CACHE_MAX_LEVELS) return false;
+    if (levels.size() > 1) levels.back().name = "LLC";
+    return true;
+}
+
+//--cache replays a recorded method, every method ("all") or a --trace file through
+//the cache simulator
+int runCacheReport(int argc, char* argv[]) {
+    std::vector<SCacheLevelConfig> levels = DEFAULT_CACHE_LEVELS;
+    std::size_t elementBytes = sizeof(int);
+    std::vector<const char*> positional;
+    for (int k = 2; k < argc; ++k) {
+        if (std::strcmp(argv[k], "--element") == 0 && k + 1 < argc) {
+            elementBytes = parseBytes(argv[++k]);
+        } else if (std::strcmp(argv[k], "--levels") == 0 && k + 1 < argc) {
+            if (!parseCacheLevels(argv[++k], levels)) elementBytes = 0;
+        } else {
+            positional.push_back(argv[k]);
+        }
+    }
+    if (positional.empty() || elementBytes == 0) {
+        std::cerr << "usage: sfml_practice --cache <method|all|trace file> [distribution] [n] [seed]"
+                     " [--element <bytes>] [--levels <bytes>/<ways>,...]" << std::endl;
+        return 1;
+    }
+    const CCacheSimulator simulator(levels, elementBytes);
+
+    const bool all = std::strcmp(positional[0], "all") == 0;
+    const int method = findName(positional[0], RECORDED_METHOD_NAMES, NUM_RECORDED_METHODS);
+    if (!all && method == NUM_RECORDED_METHODS) {
+        std::ifstream in(positional[0]);
+        SStepBuffer steps;
+        if (!in || !readTrace(in, steps)) {
+            std::cerr << "Could not read the trace " << positional[0] << std::endl;
+            return 1;
+        }
+        int n = 0;
+        for (int k = 0; k < steps.size; ++k) n = std::max({n, steps[k].i + 1, steps[k].j + 1});
+        std::cout << positional[0] << ", n = " << n << ", " << elementBytes << "-byte elements" << std::endl;
+        printCacheReport(std::cout, simulator.replay(steps, n), levels);
+        return 0;
+    }
+
+    DistKind dist = DIST_UNIFORM;
+    if (positional.size() > 1) {
+        dist = static_cast<DistKind>(findName(positional[1], DIST_NAMES, DIST_COUNT));
+        if (dist == DIST_COUNT) {
+            std::cerr << "Unknown distribution \"" << positional[1] << "\"" << std::endl;
+            return 1;
+        }
+    }
+    int n = positional.size() > 2 ? std::max(std::atoi(positional[2]), 1) : NUMBER_OF_COLUMNS;
+    std::uint64_t seed = positional.size() > 3 ? std::strtoull(positional[3], nullptr, 10) : 42;
+
+    std::vector<int> values(static_cast<std::size_t>(n));
+    CInputGenerator(dist, seed, 20, 419).fill(values.data(), n);
+
+    CArena arena;
+    auto replayMethod = [&](int m) {
+        std::vector<int> input = values;
+        arena.reset();
+        SStepBuffer steps;
+        steps.arena = &arena;
+        recordSteps(m, input.data(), n, steps, arena);
+        return simulator.replay(steps, n);
+    };
+
+    if (!all && isQuadraticMethod(method) && n > CACHE_QUADRATIC_MAX_N) {
+        std::cerr << RECORDED_METHOD_NAMES[method] << " records about n^2 steps, n is limited to "
+                  << CACHE_QUADRATIC_MAX_N << std::endl;
+        return 1;
+    }
+
+    std::cout << DIST_NAMES[dist] << ", n = " << n << ", seed = " << seed << ", "
+              << elementBytes << "-byte elements" << std::endl;
+    if (!all) {
+        printCacheReport(std::cout, replayMethod(method), levels);
+        return 0;
+    }
+
+    std::cout << std::left << std::setw(METHOD_COLUMN_WIDTH) << "method" << std::right << std::setw(14) << "accesses";
+    for (auto &level : levels) std::cout << std::setw(12) << level.name + " miss";
+    std::cout << std::endl;
+    for (int m = 0; m < NUM_RECORDED_METHODS; ++m) {
+        std::cout << std::left << std::setw(METHOD_COLUMN_WIDTH) << RECORDED_METHOD_NAMES[m] << std::right;
+        if (isQuadraticMethod(m) && n > CACHE_QUADRATIC_MAX_N) {
+            std::cout << std::setw(14) << "skipped" << std::endl;
+            continue;
+        }
+        SCacheReport r = replayMethod(m);
+        std::cout << std::setw(14) << r.accesses;
+        long long reaching = r.accesses;
+        for (std::size_t l = 0; l < levels.size(); ++l) {
+            std::cout << std::setw(12) << formatPercent(r.misses[l], reaching);
+            reaching = r.misses[l];
+        }
+        std::cout << std::endl;
+    }
     return 0;
+}
+
+//usage: sfml_practice [--profile <trace.json>] [--steps ... | --trace ... | --cache ...]
+//with --profile, zones are recorded and written as a Chrome trace on exit
+int main(int argc, char* argv[]) {
+    const char* profilePath = nullptr;
+    if (argc > 2 && std::strcmp(argv[1], "--profile") == 0) {
+        profilePath = argv[2];
+        CProfiler::enable();
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    int status = 0;
+    if (argc > 1 && (std::strcmp(argv[1], "--steps") == 0 || std::strcmp(argv[1], "--trace") == 0)) {
+        status = runHeadless(argc, argv);
+    } else if (argc > 1 && std::strcmp(argv[1], "--cache") == 0) {
+        status = runCacheReport(argc, argv);
+    } else {
+        //the app joins its recording threads when it is destroyed
+        CApp app;
+        app.run();
+    }
+
+    if (profilePath && !CProfiler::writeChromeTrace(profilePath)) {
+        std::cerr << "Could not write the profile to " << profilePath << std::endl;
+        status = 1;
+    }
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#runs PROGRAM --steps DISTRIBUTION 1000 42 and fails unless its output matches BASELINE.
+#After an intended change, regenerate the baseline with the same command
+execute_process(COMMAND ${PROGRAM} --steps ${DISTRIBUTION} 1000 42
+    OUTPUT_VARIABLE actual
+    RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "${PROGRAM} --steps ${DISTRIBUTION} 1000 42 exited with ${status}")
+endif()
+
+file(READ ${BASELINE} expected)
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "step counts for ${DISTRIBUTION} differ from ${BASELINE}\nexpected:\n${expected}\nactual:\n${actual}")
+endif()